@@ -0,0 +1,47 @@
+#include "bench_util.h"
+
+// Debug-heavy workload with a rare error, with and without backtrace mode.
+// Without backtrace every DEBUG record is formatted by the sink, with it
+// DEBUG records stay in memory and only the context of each error is
+// formatted, the difference shows up in cpu_ms.
+//
+// Usage: nvlog_bench_backtrace [producers] [records_per_producer]
+namespace {
+
+void Run(const std::string& name, bool backtrace, int producers,
+         int records) {
+  auto sink = std::make_shared<nvlog::bench::DiscardSink>();
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+  nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                       sinks);
+  if (backtrace) {
+    nvlog::BacktraceOptions options;
+    options.capacity = 32;
+    logger.EnableBacktrace(options);
+  }
+  logger.StartEngine();
+
+  nvlog::bench::Stopwatch stopwatch;
+  nvlog::bench::RunProducers(producers, [&logger, records](int /*id*/) {
+    for (int i = 0; i < records; ++i) {
+      bool error = i % 10000 == 9999;
+      logger.Log(error ? nvlog::LogLevel::Error : nvlog::LogLevel::Debug,
+                 "request " + std::to_string(i) + " handled", "BENCH",
+                 __FILE__, __LINE__);
+    }
+  });
+  logger.ShutdownEngine();
+  nvlog::bench::PrintResult(name, static_cast<size_t>(producers) * records,
+                            stopwatch);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int producers = argc > 1 ? std::stoi(argv[1]) : 4;
+  int records = argc > 2 ? std::stoi(argv[2]) : 100000;
+
+  Run("debug formatted", false, producers, records);
+  Run("debug in backtrace", true, producers, records);
+  return 0;
+}
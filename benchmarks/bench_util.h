@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvlog/nvlog.h"
+
+namespace nvlog {
+namespace bench {
+
+// Sink that renders every record like a real text sink and throws the
+// text away, so the benchmark measures the pipeline, not the disk.
+class DiscardSink : public AsyncSink {
+ public:
+  size_t Bytes() const {
+    return bytes_;
+  }
+
+ protected:
+  void Process(const LogMessagePtr& log_message) override {
+    std::string scratch;
+    bytes_ += Render(*log_message, scratch).size();
+  }
+
+ private:
+  size_t bytes_ = 0;
+};
+
+// Wall clock and process CPU time of a scope
+class Stopwatch {
+ public:
+  Stopwatch()
+                  : wall_start_(std::chrono::steady_clock::now()),
+                    cpu_start_(std::clock()) {}
+
+  double WallMs() const {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - wall_start_)
+        .count();
+  }
+
+  double CpuMs() const {
+    return 1000.0 * static_cast<double>(std::clock() - cpu_start_) /
+           CLOCKS_PER_SEC;
+  }
+
+ private:
+  std::chrono::steady_clock::time_point wall_start_;
+  std::clock_t cpu_start_;
+};
+
+// Run ```fn(thread_index)``` on ```threads``` producer threads and join
+template <typename Fn>
+void RunProducers(int threads, Fn fn) {
+  std::vector<std::thread> producers;
+  for (int i = 0; i < threads; ++i) {
+    producers.emplace_back(fn, i);
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+}
+
+inline void PrintResult(const std::string& name, size_t records,
+                        const Stopwatch& stopwatch) {
+  double wall = stopwatch.WallMs();
+  std::cout << std::left << std::setw(32) << name << std::right
+            << " records=" << std::setw(9) << records
+            << " wall_ms=" << std::setw(9) << std::fixed
+            << std::setprecision(1) << wall << " cpu_ms=" << std::setw(9)
+            << stopwatch.CpuMs() << " rec/s=" << std::setw(11)
+            << std::setprecision(0) << (records / (wall / 1000.0))
+            << std::endl;
+}
+
+}  // namespace bench
+}  // namespace nvlog
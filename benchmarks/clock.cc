@@ -0,0 +1,72 @@
+#include "bench_util.h"
+
+// Producer side cost of timestamping.
+// First the raw clock reads, then ```Logger::Log()``` latency measured by
+// the latency histogram with ```ClockSource::System``` and
+// ```ClockSource::Tsc```.
+//
+// Usage: nvlog_bench_clock [producers] [records_per_producer]
+namespace {
+
+template <typename Fn>
+void TimeRead(const std::string& name, Fn fn) {
+  const int iterations = 10000000;
+  uint64_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    sink += fn();
+  }
+  double ns = std::chrono::duration<double, std::nano>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  std::cout << std::left << std::setw(32) << name << std::fixed
+            << std::setprecision(2) << ns / iterations << " ns/read"
+            << (sink == 42 ? " " : "") << std::endl;
+}
+
+void Run(const std::string& name, nvlog::ClockSource source, int producers,
+         int records) {
+  auto sink = std::make_shared<nvlog::bench::DiscardSink>();
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+  nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                       sinks);
+  if (!logger.SetClockSource(source)) {
+    std::cout << name << ": clock source not available" << std::endl;
+    return;
+  }
+  logger.EnableLatencyMetrics();
+  logger.StartEngine();
+
+  nvlog::bench::Stopwatch stopwatch;
+  nvlog::bench::RunProducers(producers, [&logger, records](int /*id*/) {
+    for (int i = 0; i < records; ++i) {
+      logger.Log(nvlog::LogLevel::Info, "request handled", "BENCH", __FILE__,
+                 __LINE__);
+    }
+  });
+  logger.ShutdownEngine();
+  nvlog::bench::PrintResult(name, static_cast<size_t>(producers) * records,
+                            stopwatch);
+
+  auto latency = logger.GetStats().log_latency;
+  std::cout << "  Log() latency ns p50=" << latency.Quantile(0.5)
+            << " p99=" << latency.Quantile(0.99)
+            << " p999=" << latency.Quantile(0.999) << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int producers = argc > 1 ? std::stoi(argv[1]) : 4;
+  int records = argc > 2 ? std::stoi(argv[2]) : 200000;
+
+  TimeRead("system_clock::now()", []() {
+    return static_cast<uint64_t>(
+        std::chrono::system_clock::now().time_since_epoch().count());
+  });
+  TimeRead("ReadTicks()", []() { return nvlog::ReadTicks(); });
+
+  Run("ClockSource::System", nvlog::ClockSource::System, producers, records);
+  Run("ClockSource::Tsc", nvlog::ClockSource::Tsc, producers, records);
+  return 0;
+}
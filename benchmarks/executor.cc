@@ -0,0 +1,69 @@
+#include <sys/resource.h>
+
+#include "bench_util.h"
+
+// One thread per AsyncSink against sinks sharing an Executor with 1, 2 and
+// 4 threads. Prints wall/cpu time and the context switches of the process
+// (voluntary + involuntary) for the same workload.
+//
+// Usage: nvlog_bench_executor [sinks] [producers] [records_per_producer]
+namespace {
+
+long ContextSwitches() {
+  rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+void Run(const std::string& name, size_t executor_threads, int sink_count,
+         int producers, int records) {
+  std::shared_ptr<nvlog::Executor> executor;
+  if (executor_threads > 0) {
+    executor = std::make_shared<nvlog::Executor>(executor_threads);
+  }
+
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks;
+  for (int i = 0; i < sink_count; ++i) {
+    auto sink = std::make_shared<nvlog::bench::DiscardSink>();
+    if (executor) {
+      sink->SetExecutor(executor);
+    }
+    sinks.push_back(sink);
+  }
+  nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                       sinks);
+  logger.StartEngine();
+
+  long switches = ContextSwitches();
+  nvlog::bench::Stopwatch stopwatch;
+  nvlog::bench::RunProducers(producers, [&logger, records](int /*id*/) {
+    for (int i = 0; i < records; ++i) {
+      logger.Log(nvlog::LogLevel::Info, "request handled", "BENCH", __FILE__,
+                 __LINE__);
+      if (i % 64 == 0) {
+        // bursty traffic, lets idle workers go to sleep
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+  });
+  logger.ShutdownEngine();
+  nvlog::bench::PrintResult(name, static_cast<size_t>(producers) * records,
+                            stopwatch);
+  std::cout << "  threads=" << (executor ? executor_threads : sink_count) + 1
+            << " context_switches=" << ContextSwitches() - switches
+            << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int sink_count = argc > 1 ? std::stoi(argv[1]) : 8;
+  int producers = argc > 2 ? std::stoi(argv[2]) : 4;
+  int records = argc > 3 ? std::stoi(argv[3]) : 20000;
+
+  Run("thread per sink", 0, sink_count, producers, records);
+  Run("executor x1", 1, sink_count, producers, records);
+  Run("executor x2", 2, sink_count, producers, records);
+  Run("executor x4", 4, sink_count, producers, records);
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <atomic>
+
+#include "bench_util.h"
+
+// End to end latency of ERROR records (producer Log to sink write) while
+// producers flood TRACE records faster than the sink writes them, with
+// one FIFO queue and with priority lanes in the channel and the sink.
+// Without lanes an error waits behind the whole backlog, with strict lanes
+// its latency stays flat however deep the flood.
+//
+// Usage: nvlog_bench_priority_lanes [flood_producers] [records_per_producer]
+namespace {
+
+// Renders every record like a text sink, records the write latency of
+// errors only
+class LatencySink : public nvlog::AsyncSink {
+ public:
+  const nvlog::LatencyHistogram& ErrorLatency() const {
+    return error_latency_;
+  }
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    std::string scratch;
+    Render(*log_message, scratch);
+    if (log_message->log_level == nvlog::LogLevel::Error) {
+      error_latency_.Record(nvlog::SteadyNowNs() - log_message->enqueue_ns);
+    }
+  }
+
+ private:
+  nvlog::LatencyHistogram error_latency_;
+};
+
+void Run(const std::string& name, bool lanes, int producers, int records) {
+  auto sink = std::make_shared<LatencySink>();
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+  nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                       sinks);
+  if (lanes) {
+    logger.SetPriorityLanes();
+    sink->SetPriorityLanes(nvlog::LaneOptions());
+  }
+  logger.EnableLatencyMetrics();
+  logger.StartEngine();
+
+  std::atomic<bool> flooding(true);
+  std::thread prober([&logger, &flooding]() {
+    while (flooding.load()) {
+      logger.Log(nvlog::LogLevel::Error, "probe", "BENCH", __FILE__,
+                 __LINE__);
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+  });
+
+  nvlog::bench::Stopwatch stopwatch;
+  nvlog::bench::RunProducers(producers, [&logger, records](int id) {
+    for (int i = 0; i < records; ++i) {
+      logger.Log(nvlog::LogLevel::Trace,
+                 "flood " + std::to_string(i) + " of " + std::to_string(id),
+                 "BENCH", __FILE__, __LINE__);
+    }
+  });
+  // Probe while the backlog drains, then stop
+  while (logger.GetStats().queue_depth + sink->QueueDepth() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  flooding.store(false);
+  prober.join();
+  logger.ShutdownEngine();
+
+  nvlog::bench::PrintResult(name, static_cast<size_t>(producers) * records,
+                            stopwatch);
+  auto latency = sink->ErrorLatency().Snapshot();
+  std::cout << "  error records=" << latency.count
+            << " p50_us=" << latency.Quantile(0.5) / 1000
+            << " p99_us=" << latency.Quantile(0.99) / 1000
+            << " max_us=" << latency.Quantile(1.0) / 1000 << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int producers = argc > 1 ? std::stoi(argv[1]) : 4;
+  int records = argc > 2 ? std::stoi(argv[2]) : 250000;
+
+  Run("trace flood, one queue", false, producers, records);
+  Run("trace flood, priority lanes", true, producers, records);
+  return 0;
+}
@@ -0,0 +1,150 @@
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "bench_util.h"
+
+// Seek a time window in a large text log with the sidecar time index,
+// against a grep-like scan of the file for the same window. The log is
+// generated with synthetic timestamps (10us apart) and indexed while it
+// is written, as DeferredFileSink does with EnableTimeIndex().
+//
+// Usage: nvlog_bench_time_index [gigabytes] [directory]
+namespace {
+
+constexpr int64_t kStartNs = 1767225600LL * 1000000000;  // 2026-01-01 UTC
+constexpr int64_t kStepNs = 10000;
+
+void Generate(const std::string& filename, uint64_t bytes) {
+  ::unlink(filename.c_str());
+  ::unlink(nvlog::TimeIndexFilename(filename).c_str());
+  std::ofstream file(filename, std::ios::binary);
+  nvlog::TimeIndexWriter index(filename, nvlog::TimeIndexFormat::Text);
+
+  nvlog::LogMessage log_message(std::chrono::system_clock::time_point(),
+                                nvlog::LogLevel::Info, "BENCH", "",
+                                __FILE__, __LINE__, "1", nullptr);
+  std::string buffer;
+  char line[256];
+  char second[32] = "";
+  int64_t current_second = -1;
+  uint64_t written = 0;
+  nvlog::bench::Stopwatch stopwatch;
+  for (uint64_t i = 0; written < bytes; ++i) {
+    int64_t ns = kStartNs + static_cast<int64_t>(i) * kStepNs;
+    if (ns / 1000000000 != current_second) {
+      current_second = ns / 1000000000;
+      std::time_t time = static_cast<std::time_t>(current_second);
+      std::strftime(second, sizeof(second), "%Y-%m-%d %H:%M:%S",
+                    std::localtime(&time));
+    }
+    log_message.log_level = i % 100000 == 99999 ? nvlog::LogLevel::Error
+                            : i % 4 == 0        ? nvlog::LogLevel::Debug
+                                                : nvlog::LogLevel::Info;
+    log_message.timestamp = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(ns)));
+    int size = std::snprintf(
+        line, sizeof(line),
+        "[%-8s] %s.%06lld [BENCH] request %llu handled by worker %llu in "
+        "%llu us\n",
+        nvlog::LevelName(log_message.log_level),
+        second, static_cast<long long>(ns / 1000 % 1000000),
+        static_cast<unsigned long long>(i),
+        static_cast<unsigned long long>(i % 64),
+        static_cast<unsigned long long>(i % 977));
+    buffer.append(line, static_cast<size_t>(size));
+    index.Add(log_message, static_cast<size_t>(size));
+    written += static_cast<uint64_t>(size);
+    if (buffer.size() >= 1024 * 1024) {
+      file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      buffer.clear();
+    }
+  }
+  file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  index.EndBlock();
+  std::cout << "generated " << written / (1024 * 1024) << " MiB in "
+            << std::fixed << std::setprecision(1) << stopwatch.WallMs()
+            << " ms" << std::endl;
+}
+
+// First offset of a line stamped ```pattern```, reading the whole file
+// in order like grep would
+uint64_t Scan(const std::string& filename, const std::string& pattern) {
+  std::ifstream file(filename, std::ios::binary);
+  std::string buffer(4 * 1024 * 1024, '\0');
+  uint64_t offset = 0;
+  while (file) {
+    file.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+    size_t got = static_cast<size_t>(file.gcount());
+    const void* found =
+        ::memmem(buffer.data(), got, pattern.data(), pattern.size());
+    if (found) {
+      return offset + (static_cast<const char*>(found) - buffer.data());
+    }
+    // Keep the tail so a match across chunks is still found
+    size_t keep = std::min(got, pattern.size());
+    offset += got - keep;
+    file.seekg(-static_cast<std::streamoff>(keep), std::ios::cur);
+    if (got < buffer.size()) {
+      break;
+    }
+  }
+  return UINT64_MAX;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  double gigabytes = argc > 1 ? std::stod(argv[1]) : 10;
+  std::string directory = argc > 2 ? argv[2] : "/tmp";
+  std::string filename =
+      directory + "/nvlog_bench_" + std::to_string(::getpid()) + ".log";
+  uint64_t bytes = static_cast<uint64_t>(gigabytes * 1024 * 1024 * 1024);
+
+  Generate(filename, bytes);
+
+  // One second window at 3/4 of the file, late enough for a scan to hurt
+  uint64_t records = bytes / 100;
+  int64_t from_ns = kStartNs + static_cast<int64_t>(records * 3 / 4) * kStepNs;
+  from_ns -= from_ns % 1000000000;
+  int64_t to_ns = from_ns + 999999999;
+
+  const int lookups = 20;
+  std::vector<nvlog::TimeIndexRange> ranges;
+  nvlog::TimeIndexFormat format;
+  nvlog::bench::Stopwatch index_stopwatch;
+  for (int i = 0; i < lookups; ++i) {
+    ranges.clear();
+    nvlog::QueryTimeIndex(filename, from_ns, to_ns, nvlog::LogLevel::Trace,
+                          &ranges, &format);
+  }
+  double lookup_ms = index_stopwatch.WallMs() / lookups;
+
+  uint64_t selected = 0;
+  for (const auto& range : ranges) {
+    selected += range.size;
+  }
+
+  std::time_t time = static_cast<std::time_t>(from_ns / 1000000000);
+  char pattern[32];
+  std::strftime(pattern, sizeof(pattern), "%Y-%m-%d %H:%M:%S",
+                std::localtime(&time));
+  nvlog::bench::Stopwatch scan_stopwatch;
+  uint64_t scan_offset = Scan(filename, pattern);
+  double scan_ms = scan_stopwatch.WallMs();
+
+  std::cout << std::fixed << std::setprecision(3)
+            << "index lookup          ms=" << lookup_ms
+            << " ranges=" << ranges.size() << " selected_bytes=" << selected
+            << " first_offset="
+            << (ranges.empty() ? 0 : ranges.front().offset) << '\n'
+            << "scan to first match   ms=" << scan_ms
+            << " first_offset=" << scan_offset << std::endl;
+
+  ::unlink(filename.c_str());
+  ::unlink(nvlog::TimeIndexFilename(filename).c_str());
+  return 0;
+}
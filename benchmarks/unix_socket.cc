@@ -0,0 +1,125 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+
+#include "bench_util.h"
+
+// Throughput of UnixSocketSink (datagram and stream) against
+// DeferredFileSink for the same workload. The collector is a thread of
+// this process reading the socket as fast as it can.
+//
+// Usage: nvlog_bench_unix_socket [producers] [records_per_producer]
+namespace {
+
+class Collector {
+ public:
+  Collector(const std::string& path, nvlog::SocketMode mode)
+                  : path_(path), mode_(mode), bytes_(0), stop_(false) {
+    ::unlink(path_.c_str());
+    int type = mode == nvlog::SocketMode::Datagram ? SOCK_DGRAM : SOCK_STREAM;
+    fd_ = ::socket(AF_UNIX, type, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path_.c_str(),
+                 sizeof(address.sun_path) - 1);
+    ::bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    if (mode == nvlog::SocketMode::Stream) {
+      ::listen(fd_, 4);
+    }
+    thread_ = std::thread(&Collector::Run, this);
+  }
+
+  ~Collector() {
+    stop_.store(true);
+    thread_.join();
+    ::close(fd_);
+    ::unlink(path_.c_str());
+  }
+
+ private:
+  void Drain(int fd) {
+    char buffer[65536];
+    pollfd p = {fd, POLLIN, 0};
+    while (!stop_.load()) {
+      if (::poll(&p, 1, 50) <= 0) {
+        continue;
+      }
+      ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+      if (n <= 0 && mode_ == nvlog::SocketMode::Stream) {
+        return;
+      }
+      bytes_ += n > 0 ? n : 0;
+    }
+  }
+
+  void Run() {
+    if (mode_ == nvlog::SocketMode::Datagram) {
+      Drain(fd_);
+      return;
+    }
+    pollfd p = {fd_, POLLIN, 0};
+    while (!stop_.load()) {
+      if (::poll(&p, 1, 50) > 0) {
+        int connection = ::accept(fd_, nullptr, nullptr);
+        Drain(connection);
+        ::close(connection);
+      }
+    }
+  }
+
+  std::string path_;
+  nvlog::SocketMode mode_;
+  int fd_;
+  size_t bytes_;
+  std::atomic<bool> stop_;
+  std::thread thread_;
+};
+
+void Run(const std::string& name, std::shared_ptr<nvlog::Sink> sink,
+         int producers, int records) {
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+  nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                       sinks);
+  logger.StartEngine();
+
+  nvlog::bench::Stopwatch stopwatch;
+  nvlog::bench::RunProducers(producers, [&logger, records](int /*id*/) {
+    for (int i = 0; i < records; ++i) {
+      logger.Log(nvlog::LogLevel::Info, "request " + std::to_string(i),
+                 "BENCH", __FILE__, __LINE__);
+    }
+  });
+  logger.ShutdownEngine();
+  nvlog::bench::PrintResult(name, static_cast<size_t>(producers) * records,
+                            stopwatch);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int producers = argc > 1 ? std::stoi(argv[1]) : 4;
+  int records = argc > 2 ? std::stoi(argv[2]) : 100000;
+  std::string path = "/tmp/nvlog_bench_" + std::to_string(::getpid());
+
+  {
+    auto sink = std::make_shared<nvlog::DeferredFileSink>(path + ".log",
+                                                          64 * 1024);
+    Run("file", sink, producers, records);
+    ::unlink((path + ".log").c_str());
+  }
+  for (auto mode : {nvlog::SocketMode::Datagram, nvlog::SocketMode::Stream}) {
+    bool datagram = mode == nvlog::SocketMode::Datagram;
+    Collector collector(path + ".sock", mode);
+    nvlog::UnixSocketSinkOptions options;
+    options.mode = mode;
+    auto sink = std::make_shared<nvlog::UnixSocketSink>(path + ".sock",
+                                                        options);
+    Run(datagram ? "unix datagram" : "unix stream", sink, producers, records);
+    std::cout << "  dropped=" << sink->Dropped() << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nvlog/declare.h"
+
+namespace nvlog {
+
+enum class BacktraceScope { PerThread, PerTag };
+
+struct BacktraceOptions {
+  // Records kept for each thread or tag, older ones are dropped
+  size_t capacity = 64;
+  // Records at or below this level are buffered instead of logged
+  LogLevel buffer_level = LogLevel::Debug;
+  // Record at or above this level flushes the buffered records first
+  LogLevel trigger_level = LogLevel::Error;
+  BacktraceScope scope = BacktraceScope::PerThread;
+  // Ring of a thread or tag without records for this long (record time)
+  // is dropped with its records, e.g. the ring of an exited thread. Zero
+  // keeps every ring.
+  std::chrono::milliseconds idle_timeout = std::chrono::seconds(60);
+};
+
+// BacktraceBuffer
+//
+// Keep the most recent low level records in memory, never formatted,
+// and only emit them when an error shows up, so the context leading to
+// the error is logged without paying for DEBUG logging all the time.
+// Rings are keyed by thread id or tag, idle rings are swept out so the
+// map doesn't grow with every thread ever seen. Not thread safe: the
+// channel calls it under its ```backtrace_mu_```, from the worker or from
+// the producers when there are synchronous sinks.
+class BacktraceBuffer {
+ public:
+  explicit BacktraceBuffer(BacktraceOptions options)
+                  : options_(options), last_sweep_ns_(0) {
+    if (options_.capacity == 0) {
+      options_.capacity = 1;
+    }
+  }
+
+  // Buffer ```log_message``` when its level is buffered.
+  // Return true when the record was taken, ```dropped``` is the number of
+  // older records dropped to make room or with an idle ring.
+  bool Offer(const LogMessagePtr& log_message, size_t& dropped) {
+    dropped = 0;
+    if (log_message->log_level > options_.buffer_level) {
+      return false;
+    }
+    int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         log_message->timestamp.time_since_epoch())
+                         .count();
+    if (IdleNs() > 0 && now_ns - last_sweep_ns_ >= IdleNs()) {
+      dropped += Sweep(now_ns);
+    }
+    Ring& ring = rings_[Key(*log_message)];
+    ring.last_ns = now_ns;
+    if (ring.records.size() < options_.capacity) {
+      ring.records.push_back(log_message);
+    } else {
+      ++dropped;
+      ring.records[ring.next] = log_message;
+      ring.next = (ring.next + 1) % options_.capacity;
+    }
+    return true;
+  }
+
+  size_t RingCount() const {
+    return rings_.size();
+  }
+
+  bool IsTrigger(const LogMessage& log_message) const {
+    return log_message.log_level >= options_.trigger_level;
+  }
+
+  // Hand the records buffered for ```trigger``` to ```fn```, oldest first,
+  // and empty that ring
+  template <typename Fn>
+  void Flush(const LogMessage& trigger, Fn fn) {
+    auto it = rings_.find(Key(trigger));
+    if (it == rings_.end()) {
+      return;
+    }
+    Ring& ring = it->second;
+    for (size_t i = 0; i < ring.records.size(); ++i) {
+      fn(ring.records[(ring.next + i) % ring.records.size()]);
+    }
+    ring.records.clear();
+    ring.next = 0;
+  }
+
+ private:
+  struct Ring {
+    std::vector<LogMessagePtr> records;
+    size_t next = 0;  // oldest record once the ring is full
+    int64_t last_ns = 0;  // time of the last record offered
+  };
+
+  int64_t IdleNs() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               options_.idle_timeout)
+        .count();
+  }
+
+  // Drop the rings idle since ```idle_timeout```, return their records
+  size_t Sweep(int64_t now_ns) {
+    last_sweep_ns_ = now_ns;
+    size_t dropped = 0;
+    for (auto it = rings_.begin(); it != rings_.end();) {
+      if (now_ns - it->second.last_ns >= IdleNs()) {
+        dropped += it->second.records.size();
+        it = rings_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    return dropped;
+  }
+
+  std::string Key(const LogMessage& log_message) const {
+    return options_.scope == BacktraceScope::PerThread
+               ? log_message.thread_id
+               : std::string(log_message.tag);
+  }
+
+  BacktraceOptions options_;
+  std::unordered_map<std::string, Ring> rings_;
+  int64_t last_sweep_ns_;
+};
+
+}  // namespace nvlog
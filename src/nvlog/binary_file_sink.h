@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "nvlog/formatter.h"
+#include "nvlog/record_codec.h"
+#include "nvlog/sink.h"
+#include "nvlog/time_index.h"
+
+namespace nvlog {
+
+// BinaryFileSink
+//
+// Append records to a file in the binary form of ```record_codec.h```,
+// nothing is formatted. Exact time and level filtering is then possible
+// when reading back with ```nvlog_query```. Writes are buffered like
+// ```DeferredFileSink```.
+class BinaryFileSink : public AsyncSink {
+ public:
+  explicit BinaryFileSink(
+      const std::string& filename, size_t max_buffer_size = 64 * 1024,
+      std::chrono::seconds flush_interval = std::chrono::seconds(5))
+                  : filename_(filename),
+                    file_(filename,
+                          std::ios::out | std::ios::app | std::ios::binary),
+                    flush_buffer_size_(max_buffer_size),
+                    max_interval_(flush_interval) {
+    if (!file_.is_open()) {
+      LogMessage log(std::chrono::system_clock::now(), LogLevel::Error,
+                     "nvlog",
+                     "BinaryFileSink failed to open log file: " + filename,
+                     __FILE__, __LINE__, GetThreadId(), nullptr);
+
+      std::ostringstream ss;
+      DefaultFormatter(ss, log);
+      std::cerr << ss.str() << std::endl;
+    }
+    last_flush_time_ = std::chrono::steady_clock::now();
+  }
+
+  ~BinaryFileSink() {
+    FlushBuffer();
+  }
+
+  bool RendersText() const override {
+    return false;
+  }
+
+  std::string Name() const override {
+    return "binary_file:" + filename_;
+  }
+
+  // Same as ```DeferredFileSink::EnableTimeIndex()```
+  void EnableTimeIndex(size_t block_bytes = 64 * 1024) {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    index_ = std::make_unique<TimeIndexWriter>(
+        filename_, TimeIndexFormat::Binary, block_bytes);
+  }
+
+ protected:
+  void Process(const LogMessagePtr& log_message) override {
+    size_t size = EncodedRecordSize(*log_message);
+    {
+      std::lock_guard<std::mutex> lock(buffer_mutex_);
+      size_t end = buffer_.size();
+      buffer_.resize(end + size);
+      EncodeRecord(*log_message, &buffer_[end]);
+      if (index_) {
+        index_->Add(*log_message, size);
+      }
+      if (buffer_.size() >= flush_buffer_size_ ||
+          std::chrono::steady_clock::now() - last_flush_time_ >=
+              max_interval_) {
+        FlushBufferLocked();
+      }
+      this->SetBufferedBytes(buffer_.size());
+    }
+    RecordWrite(*log_message, size);
+  }
+
+  void SyncBuffers() override {
+    FlushBuffer();
+  }
+
+  void Flush() override {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    FlushBufferLocked();
+    if (index_) {
+      index_->EndBlock();
+    }
+  }
+
+ private:
+  std::string filename_;
+  std::ofstream file_;
+  size_t flush_buffer_size_;
+  std::chrono::seconds max_interval_;
+  std::string buffer_;
+  std::chrono::steady_clock::time_point last_flush_time_;
+  std::mutex buffer_mutex_;
+  std::unique_ptr<TimeIndexWriter> index_;
+
+  void FlushBuffer() {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    FlushBufferLocked();
+  }
+
+  // buffer_mutex_ must be held
+  void FlushBufferLocked() {
+    if (!buffer_.empty()) {
+      file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+      file_.flush();
+      buffer_.clear();
+      this->SetBufferedBytes(0);
+      last_flush_time_ = std::chrono::steady_clock::now();
+    }
+  }
+};
+
+}  // namespace nvlog
@@ -1,116 +1,567 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <utility>
 #include <vector>
 
-#include "nvlog/concurrent_queue.h"
+#include "nvlog/backtrace.h"
+#include "nvlog/clock.h"
 #include "nvlog/declare.h"
+#include "nvlog/level_throttle.h"
 #include "nvlog/limiters/rate_limiter.h"
+#include "nvlog/memory_budget.h"
+#include "nvlog/metrics.h"
+#include "nvlog/priority_lanes.h"
+#include "nvlog/rcu.h"
 #include "nvlog/sink.h"
+#include "nvlog/tag_registry.h"
+#include "nvlog/work_queue.h"
+#include "nvlog/worker_options.h"
 
 namespace nvlog {
 
+// Sinks of a channel, published as one immutable snapshot: producers and
+// the worker read it without a lock, ```AddSink```/```RemoveSink``` swap
+// in a new one (see ```RcuPtr```).
+struct ChannelConfig {
+  std::vector<std::shared_ptr<Sink>> sinks;
+  bool has_sync = false;   // a sink is written on the producer threads
+  bool has_async = false;  // records go through the channel worker
+
+  explicit ChannelConfig(std::vector<std::shared_ptr<Sink>> s = {})
+                  : sinks(std::move(s)) {
+    Classify();
+  }
+
+  void Classify() {
+    has_sync = false;
+    has_async = sinks.empty();
+    for (const auto& sink : sinks) {
+      if (sink->IsSynchronous()) {
+        has_sync = true;
+      } else {
+        has_async = true;
+      }
+    }
+  }
+};
+
 class Channel {
  public:
   explicit Channel(std::shared_ptr<nvlog::limiters::RateLimiter> rate_limiter)
-                  : rate_limiter_(rate_limiter), running_(false) {}
+                  : config_(std::make_unique<ChannelConfig>()),
+                    rate_limiter_(rate_limiter),
+                    running_(false),
+                    prepare_shutdown_(false) {
+    worker_options_.name = "nvlog-channel";
+  }
 
   explicit Channel(std::shared_ptr<nvlog::limiters::RateLimiter> rate_limiter,
                    std::vector<std::shared_ptr<nvlog::Sink>>& sinks)
-                  : sinks_(sinks),
+                  : config_(std::make_unique<ChannelConfig>(sinks)),
                     rate_limiter_(rate_limiter),
-                    running_(false) {}
+                    running_(false),
+                    prepare_shutdown_(false) {
+    worker_options_.name = "nvlog-channel";
+  }
 
   ~Channel() {}
 
   void Start() {
+    std::lock_guard<std::mutex> lock(config_mu_);
     if (running_)
       return;
     running_ = true;
-    for (const auto& sink : sinks_) {
+    prepare_shutdown_.store(false);
+    const ChannelConfig* config = config_.Load();
+    for (const auto& sink : config->sinks) {
       sink->Start();
     }
-    worker_thread_ = std::thread(&Channel::Process, this);
+    // Only synchronous sinks: everything runs on the producer threads
+    if (config->has_async) {
+      StartWorker();
+    }
   }
 
   bool IsRun() const {
     return running_.load();
   }
 
+  // Wait strategy, CPU affinity and name of the worker thread.
+  // Must be called before ```Start()```.
+  void SetWorkerOptions(WorkerOptions options) {
+    worker_options_ = options;
+    queue_.SetWaitStrategy(options.wait_strategy);
+  }
+
   void Shutdown(bool force) {
-    if(!running_.load() || prepare_shutdown_.load())
+    if (!running_.load() || prepare_shutdown_.exchange(true))
       return;
+    std::lock_guard<std::mutex> lock(config_mu_);
+
+    // From here ```Enqueue``` refuses records. Wait for the producers that
+    // passed its check before, they enqueue inside a read section.
+    RcuDomain::Instance().Synchronize();
+
+    // Null is the end marker, everything enqueued before it is dispatched
+    // to the sinks before they are shut down, so no tail record is lost.
+    queue_.Enqueue(nullptr);
+    if (worker_thread_.joinable()) {
+      worker_thread_.join();
+    }
 
-    prepare_shutdown_ = true;
-    queue_.Enqueue(nullptr);  // Enqueue a null to unblock the worker thread
     // sink have different rate for shutdown
-    // 1 sink can goes black first without finished the log
-    for (const auto& sink : sinks_) {
+    for (const auto& sink : config_.Load()->sinks) {
       // each sink already joined inside shutdown
       sink->Shutdown();
     }
     running_.store(false);
-    queue_.Enqueue(nullptr);
-    if (worker_thread_.joinable()) {
-      worker_thread_.join();
+  }
+
+  // Wait until the records enqueued so far are handed to the sinks, then
+  // for each sink to write them and its buffers (```Sink::Sync```), the
+  // engine keeps running. A null record queued behind the others marks
+  // the point the worker must reach. Return false when ```timeout```
+  // expires first. Not from a sink.
+  bool Sync(std::chrono::milliseconds timeout) {
+    if (!running_.load()) {
+      return false;
+    }
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::vector<std::shared_ptr<Sink>> sinks;
+    bool has_async;
+    {
+      RcuReadGuard guard;
+      sinks = config_.Load()->sinks;
+      has_async = config_.Load()->has_async;
+    }
+    if (has_async) {
+      std::unique_lock<std::mutex> lock(sync_mu_);
+      uint64_t target = ++sync_requested_;
+      queue_.Enqueue(nullptr);
+      if (!sync_cond_.wait_until(lock, deadline, [this, target] {
+            return synced_ >= target;
+          })) {
+        return false;
+      }
     }
+    for (const auto& sink : sinks) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0 || !sink->Sync(left)) {
+        return false;
+      }
+    }
+    return true;
   }
 
-  void Enqueue(const std::shared_ptr<LogMessage>& log_message) {
+  // Crash path, see ```Sink::EmergencyDrain```.
+  // Sink queues hold the oldest records so they go first,
+  // records not yet dispatched by the channel go to ```fallback_fd```.
+  // No read section here (not async-signal-safe on a new thread), the
+  // process is going down and nothing is reclaimed anymore.
+  void EmergencyDrain(int fallback_fd) {
+    for (const auto& sink : config_.Load()->sinks) {
+      sink->EmergencyDrain(fallback_fd);
+    }
+    EmergencyWriter writer(fallback_fd);
+    queue_.TryForEach(
+        [&writer](const LogMessagePtr& log_message) {
+          if (log_message) {
+            writer.Write(*log_message);
+          }
+        });
+  }
+
+  // Rate limiter check, made by the logger before the record is built
+  bool AllowRate() {
     if (!rate_limiter_ || rate_limiter_->Allow()) {
-      queue_.Enqueue(log_message);
+      return true;
+    }
+    metrics_.rate_limited.Add();
+    return false;
+  }
+
+  // With synchronous sinks the record is routed on the calling thread,
+  // written to them inline and only queued for the asynchronous ones.
+  // The record already passed ```AllowRate()```. Once a shutdown started
+  // and until the next ```Start()``` records are dropped and counted,
+  // nothing would deliver them.
+  void Enqueue(LogMessagePtr log_message) {
+    RcuReadGuard guard;
+    if (prepare_shutdown_.load()) {
+      metrics_.dropped.Add();
+      return;
+    }
+    if (budget_ && !budget_->Admit(*log_message)) {
+      metrics_.budget_shed.Add();
+      return;
+    }
+    metrics_.enqueued.Add();
+    EnqueueAdmitted(std::move(log_message));
+  }
+
+  ChannelMetrics& Metrics() {
+    return metrics_;
+  }
+
+  LoggerStats GetStats() const {
+    LoggerStats stats;
+    stats.enqueued = metrics_.enqueued.Load();
+    stats.dropped = metrics_.dropped.Load();
+    stats.rate_limited = metrics_.rate_limited.Load();
+    stats.queue_depth = queue_.Size();
+    if (budget_) {
+      stats.budget_limit = budget_->Limit();
+      stats.budget_bytes = budget_->Bytes();
+      stats.budget_high_water = budget_->HighWater();
     }
+    stats.budget_shed = metrics_.budget_shed.Load();
+    stats.log_latency = metrics_.log_latency.Snapshot();
+    RcuReadGuard guard;
+    for (const auto& sink : config_.Load()->sinks) {
+      stats.sinks.push_back(sink->Stats());
+    }
+    return stats;
   }
 
+  // Records waiting in the channel queue plus the deepest sink queue,
+  // sampled by the ```LevelThrottle```. ```now_ns``` is left to the caller.
+  ThrottleSample SampleBacklog() const {
+    ThrottleSample sample;
+    sample.enqueued = metrics_.enqueued.Load();
+    size_t deepest = 0;
+    RcuReadGuard guard;
+    for (const auto& sink : config_.Load()->sinks) {
+      deepest = std::max(deepest, sink->QueueDepth());
+    }
+    sample.backlog = queue_.Size() + deepest;
+    return sample;
+  }
+
+  // Can be called while running: the sink is started, then published
+  // to producers and worker with the next snapshot. Not from a sink.
   void AddSink(std::shared_ptr<Sink> sink) {
-    sinks_.push_back(sink);
+    std::lock_guard<std::mutex> lock(config_mu_);
+    if (budget_ && !sink->IsRun()) {
+      sink->SetMemoryBudget(budget_);
+    }
+    if (running_) {
+      sink->Start();
+    }
+    config_.Update([&sink](ChannelConfig& config) {
+      config.sinks.push_back(sink);
+      config.Classify();
+    });
+    if (running_ && config_.Load()->has_async) {
+      StartWorker();
+    }
+  }
+
+  // Stop dispatching to ```sink```, then shut it down once no thread can
+  // still hand it a record. Return false when it is not a sink of this
+  // channel. Not from a sink.
+  bool RemoveSink(const std::shared_ptr<Sink>& sink) {
+    std::lock_guard<std::mutex> lock(config_mu_);
+    bool found = false;
+    config_.Update([&sink, &found](ChannelConfig& config) {
+      auto it = std::find(config.sinks.begin(), config.sinks.end(), sink);
+      if (it != config.sinks.end()) {
+        config.sinks.erase(it);
+        config.Classify();
+        found = true;
+      }
+    });
+    if (found && running_) {
+      sink->Shutdown();
+    }
+    return found;
+  }
+
+  // Convert raw tick timestamps of ```ClockSource::Tsc``` records on the
+  // worker thread. Must be called before ```Start()```.
+  void EnableTickClock() {
+    if (!tick_converter_) {
+      tick_converter_ = std::make_unique<TickConverter>();
+    }
+  }
+
+  // Queue records per severity class, see ```PriorityLanes```.
+  // Must be called before ```Start()```.
+  void SetPriorityLanes(LaneOptions options) {
+    queue_.GetStore().Configure(options);
+  }
+
+  // Cap the bytes held by records in flight and sink buffers, see
+  // ```MemoryBudget```. Must be called before ```Start()```.
+  void SetMemoryBudget(MemoryBudgetOptions options) {
+    std::lock_guard<std::mutex> lock(config_mu_);
+    budget_ = std::make_shared<MemoryBudget>(options);
+    for (const auto& sink : config_.Load()->sinks) {
+      sink->SetMemoryBudget(budget_);
+    }
+  }
+
+  // Buffer low level records and only emit them before an error,
+  // see ```BacktraceBuffer```. Must be called before ```Start()```.
+  void EnableBacktrace(BacktraceOptions options) {
+    backtrace_ = std::make_unique<BacktraceBuffer>(options);
   }
 
  private:
+  enum class SinkSelect { All, Sync, Async };
+
+  // config_mu_ must be held
+  void StartWorker() {
+    if (!worker_thread_.joinable()) {
+      worker_thread_ = std::thread(&Channel::Process, this);
+    }
+  }
+
   void Process() {
-    while (running_.load()) {
-      std::shared_ptr<LogMessage> log_message;
+    ConfigureCurrentThread(worker_options_);
+    while (true) {
+      LogMessagePtr log_message;
       queue_.WaitAndDequeue(log_message);
       if (log_message) {
-        for (const auto& sink : sinks_) {
-          sink->Log(log_message);
+        Consume(log_message);
+      } else if (prepare_shutdown_.load()) {
+        break;
+      } else {
+        std::lock_guard<std::mutex> lock(sync_mu_);
+        ++synced_;
+        sync_cond_.notify_all();
+      }
+    }
+
+    // Records queued behind the end marker, e.g. logged by a sink while
+    // the worker routed the last records; producers can't add more
+    size_t pending = queue_.Size();
+    LogMessagePtr log_message;
+    while (pending-- != 0 && queue_.TryDequeue(log_message)) {
+      if (log_message) {
+        Consume(log_message);
+      }
+    }
+    {
+      // Everything before the end marker is dispatched
+      std::lock_guard<std::mutex> lock(sync_mu_);
+      synced_ = sync_requested_;
+      sync_cond_.notify_all();
+    }
+#if NVLOG_DEBUG == 1 && NVLOG_TRACE == 1
+    std::cout << "Channel::Terminated" << std::endl;
+#endif
+  }
+
+  // Worker side: records already routed by the producer (synchronous
+  // sinks present) only go to the asynchronous sinks.
+  void Consume(const LogMessagePtr& log_message) {
+    RcuReadGuard guard;
+    const ChannelConfig& config = *config_.Load();
+    if (log_message->routed) {
+      Dispatch(log_message, config, SinkSelect::Async, accepted_);
+    } else {
+      RouteOnThread(log_message, config, false);
+    }
+  }
+
+  // Records logged by a sink from its ```Process``` while this thread
+  // routes a record, to this channel or another one
+  struct RouteState {
+    bool routing = false;
+    std::vector<std::pair<Channel*, LogMessagePtr>> deferred;
+  };
+
+  static RouteState& LocalRouteState() {
+    static thread_local RouteState state;
+    return state;
+  }
+
+  void EnqueueAdmitted(LogMessagePtr log_message) {
+    RouteState& state = LocalRouteState();
+    if (state.routing) {
+      state.deferred.emplace_back(this, std::move(log_message));
+      return;
+    }
+    RcuReadGuard guard;
+    const ChannelConfig& config = *config_.Load();
+    if (config.has_sync) {
+      RouteOnThread(log_message, config, true);
+    } else {
+      queue_.Enqueue(std::move(log_message));
+    }
+  }
+
+  // A sink logging from its ```Process``` must not re-enter ```Route```
+  // (scratch buffers, backtrace lock, the sink own lock): its records
+  // wait until the outer record is written, then are enqueued in order.
+  void RouteOnThread(const LogMessagePtr& log_message,
+                     const ChannelConfig& config, bool producer) {
+    RouteState& state = LocalRouteState();
+    state.routing = true;
+    Route(log_message, config, producer);
+    state.routing = false;
+    while (!state.deferred.empty()) {
+      auto deferred = std::move(state.deferred);
+      state.deferred.clear();
+      for (auto& entry : deferred) {
+        entry.first->EnqueueAdmitted(std::move(entry.second));
+      }
+    }
+  }
+
+  // Backtrace mode sits in front of the sinks: buffered records are not
+  // dispatched, a trigger record first dispatches its buffered context.
+  // Runs on the worker, or on the producers when there are synchronous
+  // sinks, hence the buffer lock.
+  void Route(const LogMessagePtr& log_message, const ChannelConfig& config,
+             bool producer) {
+    if (log_message->ticks != 0 && tick_converter_) {
+      tick_converter_->MaybeRecalibrate(log_message->ticks);
+      log_message->timestamp =
+          tick_converter_->ToTimePoint(log_message->ticks);
+    }
+    if (backtrace_) {
+      std::lock_guard<std::mutex> lock(backtrace_mu_);
+      size_t dropped;
+      if (backtrace_->Offer(log_message, dropped)) {
+        if (dropped != 0) {
+          metrics_.dropped.Add(dropped);
         }
+        return;
       }
-      if (prepare_shutdown_.load())
-        break;
+      if (backtrace_->IsTrigger(*log_message)) {
+        backtrace_->Flush(*log_message,
+                          [this, &config, producer](
+                              const LogMessagePtr& record) {
+                            Deliver(record, config, producer);
+                          });
+      }
+      Deliver(log_message, config, producer);
+      return;
     }
+    Deliver(log_message, config, producer);
+  }
 
-    while (prepare_shutdown_.load()) {
-      if (!queue_.Empty()) {
-        std::shared_ptr<LogMessage> log_message;
-        queue_.TryDequeue(log_message);
-        if (log_message) {
-          for (const auto& sink : sinks_) {
-            sink->Log(log_message);
-          }
+  // On the worker every sink is written. A producer writes the synchronous
+  // sinks and queues the record, marked routed, for the other ones.
+  void Deliver(const LogMessagePtr& log_message, const ChannelConfig& config,
+               bool producer) {
+    if (!producer) {
+      Dispatch(log_message, config, SinkSelect::All, accepted_);
+      return;
+    }
+    static thread_local std::vector<Sink*> accepted;
+    Dispatch(log_message, config, SinkSelect::Sync, accepted);
+    if (config.has_async) {
+      log_message->routed = true;
+      queue_.Enqueue(log_message);
+    }
+  }
+
+  // Hand the message only to sinks whose filter accepts it,
+  // rejected messages cost the sink no queue operation and no refcount.
+  // Sinks take the reference by value and move it along their queue.
+  // Tag is interned at most once, and only when a sink filters on tags.
+  // ```select``` picks the sinks written on this thread when the
+  // channel has both kinds.
+  void Dispatch(const LogMessagePtr& log_message, const ChannelConfig& config,
+                SinkSelect select, std::vector<Sink*>& accepted) {
+    accepted.clear();
+    bool looked_up = false;
+    for (const auto& sink : config.sinks) {
+      if (select != SinkSelect::All &&
+          sink->IsSynchronous() != (select == SinkSelect::Sync)) {
+        continue;
+      }
+      const SinkFilter& filter = sink->Filter();
+      if (!filter.AcceptsLevel(log_message->log_level)) {
+        continue;
+      }
+      if (filter.HasTagFilter()) {
+        // Looked up, never interned: a tag without an ID is in no filter
+        // set, runtime tags must not grow the registry
+        if (log_message->tag_id == kUnresolvedTagId && !looked_up) {
+          log_message->tag_id = TagRegistry::Instance().Find(log_message->tag);
+          looked_up = true;
         }
+        if (!filter.AcceptsTag(log_message->tag_id)) {
+          continue;
+        }
+      }
+      accepted.push_back(sink.get());
+    }
 
-        if (!running_.load()) {
-          prepare_shutdown_.store(false);
-#if  NVLOG_DEBUG == 1 && NVLOG_TRACE == 1
-          std::cout << "Channel::Terminated" << std::endl;
-#endif
+    if (accepted.empty()) {
+      return;
+    }
+    RenderShared(*log_message, accepted);
+    // One count update for every sink, each one adopts its reference
+    log_message.Share(static_cast<uint32_t>(accepted.size()));
+    for (Sink* sink : accepted) {
+      sink->Log(LogMessagePtr::Adopt(log_message.get()));
+    }
+  }
+
+  // Render the message once per formatter shared by two or more accepted
+  // sinks. The text is attached to the message before it is published to
+  // the sink queues and never modified afterwards, sinks only do the I/O.
+  // Formatter used by a single sink is left to that sink thread.
+  void RenderShared(LogMessage& log_message,
+                    const std::vector<Sink*>& accepted) {
+    size_t before = log_message.rendered.size();
+    size_t bytes = log_message.budget ? log_message.PayloadBytes() : 0;
+    for (size_t i = 0; i < accepted.size(); ++i) {
+      if (!accepted[i]->RendersText()) {
+        continue;
+      }
+      Formatter formatter = accepted[i]->GetFormatter();
+      if (log_message.FindRendered(formatter)) {
+        continue;
+      }
+      for (size_t j = i + 1; j < accepted.size(); ++j) {
+        if (accepted[j]->RendersText() &&
+            accepted[j]->GetFormatter() == formatter) {
+          std::ostringstream ss;
+          formatter(ss, log_message);
+          log_message.rendered.push_back(RenderedText{formatter, ss.str()});
           break;
         }
       }
     }
+    // Rendered text is charged to the budget that admitted the record
+    if (log_message.budget && log_message.rendered.size() != before) {
+      log_message.Charge(log_message.PayloadBytes() - bytes);
+    }
   }
 
-  ConcurrentQueue<std::shared_ptr<LogMessage>> queue_;
-  std::vector<std::shared_ptr<Sink>> sinks_;
+  // First member: destroyed after the records still queued
+  std::shared_ptr<MemoryBudget> budget_;
+  WorkQueue<LogMessagePtr, PriorityLanes> queue_;
+  WorkerOptions worker_options_;
+  RcuPtr<ChannelConfig> config_;
+  std::mutex config_mu_;  // Start, Shutdown and sink changes
+  std::vector<Sink*> accepted_;  // scratch of Dispatch, worker thread only
   std::shared_ptr<nvlog::limiters::RateLimiter> rate_limiter_;
+  std::unique_ptr<BacktraceBuffer> backtrace_;
+  std::mutex backtrace_mu_;
+  std::unique_ptr<TickConverter> tick_converter_;
+  ChannelMetrics metrics_;
   std::thread worker_thread_;
   std::atomic<bool> running_;
-  std::atomic<bool> prepare_shutdown_;
+  std::atomic<bool> prepare_shutdown_;  // from a shutdown to the next start
+
+  // ```Sync()``` markers queued and reached by the worker
+  std::mutex sync_mu_;
+  std::condition_variable sync_cond_;
+  uint64_t sync_requested_ = 0;
+  uint64_t synced_ = 0;
 };
 
 }  // namespace nvlog
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "nvlog/clock.h"
+
+#if NVLOG_HAS_TSC
+#include <cpuid.h>
+#endif
+
+namespace nvlog {
+
+bool TicksAreInvariant() {
+#if NVLOG_HAS_TSC
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) {
+    return false;
+  }
+  return (edx & (1u << 8)) != 0;
+#else
+  return true;
+#endif
+}
+
+TickConverter::TickConverter(std::chrono::milliseconds interval)
+                : interval_(interval),
+                  sequence_(0),
+                  anchor_ticks_(0),
+                  anchor_ns_(0),
+                  ns_per_tick_(1.0),
+                  interval_ticks_(0) {
+  // First ratio from a short busy window, refined by every recalibration
+  origin_ = TakeSample();
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+  Sample end = TakeSample();
+
+  double ns_per_tick = 1.0;
+  if (end.ticks > origin_.ticks) {
+    ns_per_tick = static_cast<double>(end.wall_ns - origin_.wall_ns) /
+                  static_cast<double>(end.ticks - origin_.ticks);
+  }
+  Publish(end, ns_per_tick);
+}
+
+std::chrono::system_clock::time_point TickConverter::ToTimePoint(
+    uint64_t ticks) const {
+  uint32_t begin;
+  uint64_t anchor_ticks;
+  int64_t anchor_ns;
+  double ns_per_tick;
+  do {
+    begin = sequence_.load(std::memory_order_acquire);
+    anchor_ticks = anchor_ticks_.load(std::memory_order_relaxed);
+    anchor_ns = anchor_ns_.load(std::memory_order_relaxed);
+    ns_per_tick = ns_per_tick_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((begin & 1u) != 0 ||
+           begin != sequence_.load(std::memory_order_relaxed));
+
+  // Ticks taken before the anchor (record queued across a recalibration)
+  // convert backward from it
+  double delta = ticks >= anchor_ticks
+                     ? static_cast<double>(ticks - anchor_ticks)
+                     : -static_cast<double>(anchor_ticks - ticks);
+  int64_t ns = anchor_ns + static_cast<int64_t>(delta * ns_per_tick);
+  return std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(ns)));
+}
+
+void TickConverter::Recalibrate() {
+  if (calibrating_.test_and_set(std::memory_order_acquire)) {
+    return;
+  }
+  Sample now = TakeSample();
+  double ns_per_tick = NsPerTick();
+  if (now.ticks > origin_.ticks && now.wall_ns > origin_.wall_ns) {
+    ns_per_tick = static_cast<double>(now.wall_ns - origin_.wall_ns) /
+                  static_cast<double>(now.ticks - origin_.ticks);
+  }
+  Publish(now, ns_per_tick);
+  calibrating_.clear(std::memory_order_release);
+}
+
+// Wall clock read between two tick reads, the tick of the pair is the
+// midpoint, which bounds the pairing error by half the read latency
+TickConverter::Sample TickConverter::TakeSample() {
+  uint64_t before = ReadTicks();
+  auto wall = std::chrono::system_clock::now();
+  uint64_t after = ReadTicks();
+
+  Sample sample;
+  sample.ticks = before + (after - before) / 2;
+  sample.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       wall.time_since_epoch())
+                       .count();
+  return sample;
+}
+
+void TickConverter::Publish(const Sample& anchor, double ns_per_tick) {
+  uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  anchor_ticks_.store(anchor.ticks, std::memory_order_relaxed);
+  anchor_ns_.store(anchor.wall_ns, std::memory_order_relaxed);
+  ns_per_tick_.store(ns_per_tick, std::memory_order_relaxed);
+  interval_ticks_.store(
+      static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(interval_)
+              .count() /
+          (ns_per_tick > 0 ? ns_per_tick : 1.0)),
+      std::memory_order_relaxed);
+
+  sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+}  // namespace nvlog
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define NVLOG_HAS_TSC 1
+#else
+#define NVLOG_HAS_TSC 0
+#endif
+
+namespace nvlog {
+
+enum class ClockSource {
+  // ```system_clock::now()``` on the producer thread
+  System,
+  // Raw ```rdtsc``` (```CLOCK_MONOTONIC_COARSE``` on non-x86) on the
+  // producer thread, converted to wall clock by the channel worker
+  Tsc
+};
+
+// Read the raw tick counter, the cheapest clock available
+inline uint64_t ReadTicks() {
+#if NVLOG_HAS_TSC
+  return __rdtsc();
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+         static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+// Return true when ticks advance at a constant rate regardless of
+// frequency scaling and sleep states (invariant TSC), so they can be
+// converted to wall clock time
+bool TicksAreInvariant();
+
+// TickConverter
+//
+// Convert raw ticks to ```system_clock``` time.
+// Keeps an anchor (ticks, wall ns) pair and a ticks to ns ratio measured
+// over the time since the first calibration. ```Recalibrate()``` moves the
+// anchor to now and refines the ratio, so the drift of converted time is
+// bounded by the ratio error over one recalibration interval.
+//
+// Read lock-free from any thread through a sequence lock. Recalibration
+// may be requested from any thread (producers convert inline for
+// synchronous sinks), concurrent requests are skipped, not queued.
+class TickConverter {
+ public:
+  explicit TickConverter(
+      std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+  std::chrono::system_clock::time_point ToTimePoint(uint64_t ticks) const;
+
+  // Recalibrate when ```ticks``` is more than one interval past the
+  // anchor. Costs a compare on the common path.
+  void MaybeRecalibrate(uint64_t ticks) {
+    uint64_t anchor = anchor_ticks_.load(std::memory_order_relaxed);
+    if (ticks > anchor &&
+        ticks - anchor > interval_ticks_.load(std::memory_order_relaxed)) {
+      Recalibrate();
+    }
+  }
+
+  void Recalibrate();
+
+  double NsPerTick() const {
+    return ns_per_tick_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Sample {
+    uint64_t ticks;
+    int64_t wall_ns;
+  };
+
+  static Sample TakeSample();
+
+  void Publish(const Sample& anchor, double ns_per_tick);
+
+  std::chrono::milliseconds interval_;
+  Sample origin_;
+
+  std::atomic_flag calibrating_ = ATOMIC_FLAG_INIT;
+  std::atomic<uint32_t> sequence_;
+  std::atomic<uint64_t> anchor_ticks_;
+  std::atomic<int64_t> anchor_ns_;
+  std::atomic<double> ns_per_tick_;
+  std::atomic<uint64_t> interval_ticks_;
+};
+
+}  // namespace nvlog
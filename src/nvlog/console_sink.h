@@ -11,29 +11,33 @@
 
 namespace nvlog {
 
-class ConsoleSink : public AsyncSink {
+// Console sink over ```AsyncSink``` (```ConsoleSink```) or ```SyncSink```
+// (```SyncConsoleSink```)
+template <typename Base>
+class BasicConsoleSink : public Base {
  private:
   /* data */
  public:
-  ConsoleSink()
+  BasicConsoleSink()
 
   {}
 
-  ~ConsoleSink() {
+  ~BasicConsoleSink() {
     // if(IsRun()){
     //   Shutdown(false);
     // }
   }
 
+  std::string Name() const override {
+    return "console";
+  }
+
  protected:
-  void Process(const std::shared_ptr<LogMessage>& log_message) override {
-    std::ostringstream ss;
-    if (formatter_) {
-      formatter_(ss, *log_message);
-    } else {
-      DefaultFormatter(ss, *log_message);
-    }
-    PrintToConsole(ss.str());
+  void Process(const LogMessagePtr& log_message) override {
+    std::string scratch;
+    const std::string& text = this->Render(*log_message, scratch);
+    PrintToConsole(text);
+    this->RecordWrite(*log_message, text.size() + 1);
   }
 
  private:
@@ -44,4 +48,7 @@ class ConsoleSink : public AsyncSink {
   }
 };
 
+using ConsoleSink = BasicConsoleSink<AsyncSink>;
+using SyncConsoleSink = BasicConsoleSink<SyncSink>;
+
 }  // namespace nvlog
@@ -0,0 +1,106 @@
+#include "nvlog/crash_handler.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+namespace nvlog {
+
+namespace {
+std::mutex install_mutex;
+std::shared_ptr<Logger> installed_logger;  // keep the logger alive
+
+// Read from the signal handler, lock-free atomics only
+std::atomic<Logger*> active_logger(nullptr);
+std::atomic<int> fallback_fd(STDERR_FILENO);
+std::atomic<bool> draining(false);
+
+CrashHandlerOptions installed_options;
+struct sigaction previous_actions[NSIG];
+bool hooked[NSIG] = {};
+}  // namespace
+
+void CrashHandler::Install(std::shared_ptr<Logger> logger,
+                           CrashHandlerOptions options) {
+  Uninstall();
+
+  std::lock_guard<std::mutex> lock(install_mutex);
+  if (!logger) {
+    return;
+  }
+  installed_logger = logger;
+  installed_options = options;
+  fallback_fd.store(options.fallback_fd);
+  draining.store(false);
+  active_logger.store(logger.get());
+
+  for (int signal : options.signals) {
+    if (signal <= 0 || signal >= NSIG) {
+      continue;
+    }
+    struct sigaction action = {};
+    action.sa_handler = &CrashHandler::OnSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_ONSTACK;
+    if (sigaction(signal, &action, &previous_actions[signal]) == 0) {
+      hooked[signal] = true;
+    }
+  }
+
+  if (options.drain_on_fatal || options.abort_on_fatal) {
+    logger->SetFatalHook(&CrashHandler::OnFatal);
+  }
+}
+
+void CrashHandler::Uninstall() {
+  std::lock_guard<std::mutex> lock(install_mutex);
+  for (int signal = 1; signal < NSIG; ++signal) {
+    if (hooked[signal]) {
+      sigaction(signal, &previous_actions[signal], nullptr);
+      hooked[signal] = false;
+    }
+  }
+  if (installed_logger) {
+    installed_logger->SetFatalHook(nullptr);
+  }
+  active_logger.store(nullptr);
+  installed_logger.reset();
+}
+
+bool CrashHandler::IsInstalled() {
+  return active_logger.load() != nullptr;
+}
+
+void CrashHandler::OnSignal(int signal) {
+  // Only the first crashing thread drains, a second fault while draining
+  // goes straight to the previous handler.
+  if (!draining.exchange(true)) {
+    Logger* logger = active_logger.load();
+    if (logger) {
+      logger->EmergencyDrain(fallback_fd.load());
+    }
+  }
+
+  sigaction(signal, &previous_actions[signal], nullptr);
+  raise(signal);
+}
+
+void CrashHandler::OnFatal() {
+  Logger* logger = active_logger.load();
+  if (!logger) {
+    return;
+  }
+  if (installed_options.abort_on_fatal) {
+    if (installed_options.drain_on_fatal) {
+      logger->ShutdownEngine();
+    }
+    std::abort();
+  }
+  // The process goes on: wait for the records to be written, the engine
+  // keeps running
+  if (installed_options.drain_on_fatal) {
+    logger->Sync();
+  }
+}
+
+}  // namespace nvlog
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <csignal>
+#include <memory>
+#include <vector>
+
+#include "nvlog/logger.h"
+
+namespace nvlog {
+
+struct CrashHandlerOptions {
+  // Where records not owned by a file sink are written while crashing
+  int fallback_fd = STDERR_FILENO;
+  // Signals to intercept, re-raised with the previous handler afterward
+  std::vector<int> signals = {SIGSEGV, SIGABRT, SIGBUS, SIGFPE};
+  // Flush every pending record when a ```Fatal``` record is logged
+  bool drain_on_fatal = true;
+  // Abort the process after the ```Fatal``` drain
+  bool abort_on_fatal = true;
+};
+
+// CrashHandler
+//
+// Opt-in handler that drains the logger when the process is going down.
+//
+// On a fatal signal, every record still queued in the channel and the
+// sinks, and the unwritten ```DeferredFileSink``` buffer, is written with
+// async-signal-safe calls, then the signal is re-raised with the previous
+// disposition so the crash (core dump, exit status) is unchanged.
+// Drain is best effort: a queue whose lock is held by a crashing thread
+// is skipped rather than risking a deadlock.
+//
+// On a ```Fatal``` record the engine is shut down gracefully instead,
+// so everything is formatted and flushed normally before abort. Without
+// ```abort_on_fatal``` the pending records are written and the sinks
+// flushed while the engine keeps running, see ```Logger::Sync```.
+class CrashHandler {
+ public:
+  static void Install(std::shared_ptr<Logger> logger,
+                      CrashHandlerOptions options = CrashHandlerOptions());
+
+  static void Uninstall();
+
+  static bool IsInstalled();
+
+ private:
+  static void OnSignal(int signal);
+  static void OnFatal();
+};
+
+}  // namespace nvlog
@@ -1,23 +1,65 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
 #include <iomanip>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 #include "macro.h"
 
 namespace nvlog {
 enum class LogLevel { Trace, Debug, Info, Warning, Error, Fatal };
 
-// Return current thread ID
+// Tag ID of a message whose tag has not been interned yet
+constexpr uint32_t kUnresolvedTagId = 0xFFFFFFFF;
+
+// Return the bit of ```level``` inside a level mask
+constexpr uint32_t LevelBit(LogLevel level) {
+  return 1u << static_cast<uint32_t>(level);
+}
+
+// Return level mask which enables ```min_level``` and every level above it
+constexpr uint32_t LevelMaskFrom(LogLevel min_level) {
+  return ~(LevelBit(min_level) - 1u) & (LevelBit(LogLevel::Fatal) * 2u - 1u);
+}
+
+// Return the upper case name of ```level```, e.g. ```INFO```
+inline const char* LevelName(LogLevel level) {
+  static const char* const kNames[] = {"TRACE", "DEBUG", "INFO",
+                                       "WARN",  "ERROR", "CRITICAL"};
+  return kNames[static_cast<int>(level)];
+}
+
+// Thread-safe ```std::localtime```: formatters run on the channel worker
+// and on sink threads at the same time
+inline std::tm LocalTime(std::time_t time) {
+  std::tm tm = {};
+#if defined(_WIN32)
+  localtime_s(&tm, &time);
+#else
+  localtime_r(&time, &tm);
+#endif
+  return tm;
+}
+
+// Return current thread ID, formatted once per thread
 // return: ```int```
 inline std::string GetThreadId() {
-  std::stringstream ss;
-  ss << std::this_thread::get_id();
-  return __NVL_RETURN_MOVE(ss.str());
+  static thread_local const std::string thread_id = []() {
+    std::stringstream ss;
+    ss << std::this_thread::get_id();
+    return ss.str();
+  }();
+  return thread_id;
 }
 
 // Hold date part from timestamp.
@@ -35,7 +77,7 @@ struct DateTimeComponent {
   static DateTimeComponent FromTimestamp(
       const std::chrono::system_clock::time_point& tp) {
     std::time_t time = std::chrono::system_clock::to_time_t(tp);
-    std::tm tm = *std::localtime(&time);
+    std::tm tm = LocalTime(time);
     auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
                             tp.time_since_epoch()) %
                         std::chrono::seconds(1);
@@ -77,6 +119,44 @@ struct DateTimeComponent {
   }
 };
 
+struct LogMessage;
+struct LogSite;
+
+// Formatter callback, render ```LogMessage``` into the buffer
+using Formatter = void (*)(std::ostringstream&, const LogMessage&);
+
+// Immutable text of a message rendered once by the channel
+// and shared by every sink using the same formatter
+struct RenderedText {
+  Formatter formatter;
+  std::string text;
+};
+
+// BudgetCounter
+//
+// Bytes held by records in flight and by sink buffers, shared by a
+// channel and its sinks, see ```MemoryBudget```. The high-water mark is
+// kept with a plain load on the common path, a CAS only on a new peak.
+struct BudgetCounter {
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> high_water{0};
+
+  void Add(uint64_t n) {
+    Raise(bytes.fetch_add(n, std::memory_order_relaxed) + n);
+  }
+
+  void Sub(uint64_t n) {
+    bytes.fetch_sub(n, std::memory_order_relaxed);
+  }
+
+  void Raise(uint64_t now) {
+    uint64_t peak = high_water.load(std::memory_order_relaxed);
+    while (now > peak && !high_water.compare_exchange_weak(
+                             peak, now, std::memory_order_relaxed)) {
+    }
+  }
+};
+
 // LogMessage struct
 //
 // Note:
@@ -86,28 +166,105 @@ struct DateTimeComponent {
 // Use at your own risks.
 struct LogMessage {
   LogLevel log_level;
+  bool routed = false;  // routed by the producer, see ```Channel::Deliver```
   std::chrono::system_clock::time_point timestamp;
-  std::string tag;
+  std::string_view tag;  // static text of the call site, or ```storage```
   std::string message;
-  std::string file;
+  std::string_view file;  // static text of the call site, or ```storage```
   int32_t line;
   std::string thread_id;
   void* data;  // custom objects, unsafe do with considerations
+  const LogSite* site = nullptr;  // call site of macro records
+  std::unique_ptr<char[]> storage;  // owned tag and file, when not static
+  uint32_t tag_id = kUnresolvedTagId;  // resolved lazily by the channel
+  uint32_t charged = 0;  // bytes counted in ```budget```
+  std::vector<RenderedText> rendered;  // cached render, written by the channel
+  uint64_t enqueue_ns = 0;  // steady clock, set when latency metrics are on
+  uint64_t ticks = 0;  // raw clock of ClockSource::Tsc, converted by channel
+  std::atomic<uint32_t> refs{1};  // owners, see ```LogMessagePtr```
+  BudgetCounter* budget = nullptr;  // set when admitted by a budget
 
+  // Tag and file are copied
   LogMessage(std::chrono::system_clock::time_point ts, LogLevel ll,
-             std::string tg, std::string msg, std::string f, int32_t ln, std::string tid, void* d = nullptr)
+             std::string_view tg, std::string msg, std::string_view f,
+             int32_t ln, std::string tid, void* d = nullptr)
                   : log_level(ll),
                     timestamp(ts),
-                    tag(std::move(tg)),
                     message(std::move(msg)),
-                    file(std::move(f)),
                     line(ln),
                     thread_id(std::move(tid)),
-                    data(d) {}
+                    data(d) {
+    Own(tg, f);
+  }
+
+  // Tag and file point at the static ```site```, nothing is copied
+  LogMessage(std::chrono::system_clock::time_point ts, const LogSite& s,
+             std::string msg, std::string tid, void* d = nullptr);
+
+  ~LogMessage() {
+    if (budget) {
+      budget->Sub(charged);
+    }
+  }
+
+  // Heap and inline bytes of the record, what a budget charges for it
+  size_t PayloadBytes() const {
+    size_t bytes = sizeof(LogMessage) + HeapBytes(message) +
+                   HeapBytes(thread_id);
+    if (storage) {
+      bytes += tag.size() + file.size();
+    }
+    bytes += rendered.capacity() * sizeof(RenderedText);
+    for (const auto& r : rendered) {
+      bytes += HeapBytes(r.text);
+    }
+    return bytes;
+  }
+
+  // Capacity of ```s``` unless the text lives inside the string object
+  // (small string optimization), already counted by ```sizeof```
+  static size_t HeapBytes(const std::string& s) {
+    const char* data = s.data();
+    const char* object = reinterpret_cast<const char*>(&s);
+    bool inline_text = data >= object && data < object + sizeof(s);
+    return inline_text ? 0 : s.capacity() + 1;
+  }
+
+  // Count ```n``` more bytes against the budget that admitted the record
+  void Charge(size_t n) {
+    if (budget) {
+      budget->Add(n);
+      charged += static_cast<uint32_t>(n);
+    }
+  }
+
+  // Copy ```tg``` and ```f``` into ```storage```, one allocation
+  void Own(std::string_view tg, std::string_view f) {
+    if (tg.empty() && f.empty()) {
+      tag = std::string_view();
+      file = std::string_view();
+      return;
+    }
+    storage.reset(new char[tg.size() + f.size()]);
+    std::memcpy(storage.get(), tg.data(), tg.size());
+    std::memcpy(storage.get() + tg.size(), f.data(), f.size());
+    tag = std::string_view(storage.get(), tg.size());
+    file = std::string_view(storage.get() + tg.size(), f.size());
+  }
+
+  // Return cached text rendered with ```formatter```, nullptr if none
+  const std::string* FindRendered(Formatter formatter) const {
+    for (const auto& r : rendered) {
+      if (r.formatter == formatter) {
+        return &r.text;
+      }
+    }
+    return nullptr;
+  }
 
   void FormatTimestamp(std::ostringstream& ss) const {
     std::time_t time = std::chrono::system_clock::to_time_t(timestamp);
-    std::tm tm = *std::localtime(&time);
+    std::tm tm = LocalTime(time);
     std::chrono::microseconds us =
         std::chrono::duration_cast<std::chrono::microseconds>(
             timestamp.time_since_epoch()) %
@@ -118,6 +275,78 @@ struct LogMessage {
   }
 };
 
+// LogMessagePtr
+//
+// Owning pointer to a ```LogMessage``` counted by the record itself, no
+// control block. Moves never touch the count; the channel takes the
+// references of every accepted sink with a single ```Share()```, and an
+// owner that sees itself as the only one frees without an atomic RMW.
+class LogMessagePtr {
+ public:
+  LogMessagePtr() = default;
+  LogMessagePtr(std::nullptr_t) {}
+
+  // Take over one reference already counted in ```log_message->refs```
+  static LogMessagePtr Adopt(LogMessage* log_message) {
+    LogMessagePtr ptr;
+    ptr.ptr_ = log_message;
+    return ptr;
+  }
+
+  LogMessagePtr(const LogMessagePtr& other) : ptr_(other.ptr_) {
+    if (ptr_) {
+      ptr_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  LogMessagePtr(LogMessagePtr&& other) noexcept : ptr_(other.ptr_) {
+    other.ptr_ = nullptr;
+  }
+
+  LogMessagePtr& operator=(LogMessagePtr other) noexcept {
+    std::swap(ptr_, other.ptr_);
+    return *this;
+  }
 
+  ~LogMessagePtr() {
+    reset();
+  }
+
+  void reset() {
+    if (ptr_) {
+      if (ptr_->refs.load(std::memory_order_acquire) == 1 ||
+          ptr_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete ptr_;
+      }
+      ptr_ = nullptr;
+    }
+  }
+
+  // Add ```count``` references at once, each handed out by ```Adopt()```
+  void Share(uint32_t count) const {
+    ptr_->refs.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  LogMessage* get() const {
+    return ptr_;
+  }
+  LogMessage* operator->() const {
+    return ptr_;
+  }
+  LogMessage& operator*() const {
+    return *ptr_;
+  }
+  explicit operator bool() const {
+    return ptr_ != nullptr;
+  }
+
+ private:
+  LogMessage* ptr_ = nullptr;
+};
+
+template <typename... Args>
+LogMessagePtr MakeLogMessage(Args&&... args) {
+  return LogMessagePtr::Adopt(new LogMessage(std::forward<Args>(args)...));
+}
 
 }  // namespace nvlog
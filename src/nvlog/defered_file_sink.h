@@ -1,20 +1,29 @@
 #pragma once
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 
 #include "nvlog/formatter.h"
 #include "nvlog/sink.h"
+#include "nvlog/time_index.h"
 
 
 namespace nvlog {
-class DeferredFileSink : public AsyncSink {
+// File sink buffering writes, over ```AsyncSink``` (```DeferredFileSink```)
+// or ```SyncSink``` (```SyncDeferredFileSink```)
+template <typename Base>
+class BasicDeferredFileSink : public Base {
  public:
-  explicit DeferredFileSink(
+  explicit BasicDeferredFileSink(
       const std::string& filename, size_t max_buffer_size = 4096,
       std::chrono::seconds flush_interval = std::chrono::seconds(5))
-                  : file_(filename, std::ios::out | std::ios::app),
+                  : filename_(filename),
+                    file_(filename, std::ios::out | std::ios::app),
                     flush_buffer_size_(max_buffer_size),
                     max_interval_(flush_interval) {
     if (!file_.is_open()) {
@@ -30,49 +39,113 @@ class DeferredFileSink : public AsyncSink {
     last_flush_time_ = std::chrono::steady_clock::now();
   }
 
-  ~DeferredFileSink() {
+  ~BasicDeferredFileSink() {
     FlushBuffer();
     if (file_.is_open()) {
       file_.close();
     }
   }
 
- protected:
-  void Process(const std::shared_ptr<LogMessage>& log_message) override {
-    std::ostringstream ss;
-    if (formatter_) {
-      formatter_(ss, *log_message);
-    } else {
-      DefaultFormatter(ss, *log_message);
+  std::string Name() const override {
+    return "file:" + filename_;
+  }
+
+  // Keep a sparse time index in ```<filename>.idx```, one entry every
+  // ```block_bytes``` of log, read by ```nvlog_query```.
+  // Must be called before ```Start()```.
+  void EnableTimeIndex(size_t block_bytes = 64 * 1024) {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    index_ = std::make_unique<TimeIndexWriter>(
+        filename_, TimeIndexFormat::Text, block_bytes);
+  }
+
+  // Crash path: the unwritten buffer and the queued records are appended
+  // to the log file itself, reopened with open(2) since std::ofstream
+  // is not async-signal-safe. Fallback fd is used when it can't be opened.
+  // The index entry of the buffered block is written first (write(2) only),
+  // the queued records land after the last entry, unindexed.
+  void EmergencyDrain(int fallback_fd) override {
+    int fd = ::open(filename_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    int target = fd >= 0 ? fd : fallback_fd;
+
+    std::unique_lock<std::mutex> lock(buffer_mutex_, std::try_to_lock);
+    if (lock.owns_lock()) {
+      if (index_) {
+        index_->EndBlock();
+      }
+      if (!buffer_.empty()) {
+        EmergencyWriter writer(target);
+        writer.Append(buffer_);
+      }
     }
+    Base::EmergencyDrain(target);
+
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+ protected:
+  void Process(const LogMessagePtr& log_message) override {
+    std::string scratch;
+    const std::string& text = this->Render(*log_message, scratch);
     {
       std::lock_guard<std::mutex> lock(buffer_mutex_);
-      buffer_ += ss.str() + "\n";
+      buffer_ += text;
+      buffer_ += '\n';
+      if (index_) {
+        index_->Add(*log_message, text.size() + 1);
+      }
       if (buffer_.size() >= flush_buffer_size_ ||
           std::chrono::steady_clock::now() - last_flush_time_ >=
               max_interval_) {
-        FlushBuffer();
+        FlushBufferLocked();
       }
+      this->SetBufferedBytes(buffer_.size());
+    }
+    this->RecordWrite(*log_message, text.size() + 1);
+  }
+
+  void SyncBuffers() override {
+    FlushBuffer();
+  }
+
+  void Flush() override {
+    FlushBuffer();
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    if (index_) {
+      index_->EndBlock();
     }
   }
 
  private:
+  std::string filename_;
   std::ofstream file_;
   size_t flush_buffer_size_;
   std::chrono::seconds max_interval_;
   std::string buffer_;
   std::chrono::steady_clock::time_point last_flush_time_;
   std::mutex buffer_mutex_;
+  std::unique_ptr<TimeIndexWriter> index_;
 
   void FlushBuffer() {
     std::lock_guard<std::mutex> lock(buffer_mutex_);
+    FlushBufferLocked();
+  }
+
+  // buffer_mutex_ must be held
+  void FlushBufferLocked() {
     if (!buffer_.empty()) {
       file_ << buffer_;
       file_.flush();
       buffer_.clear();
+      this->SetBufferedBytes(0);
       last_flush_time_ = std::chrono::steady_clock::now();
     }
   }
 };
 
+using DeferredFileSink = BasicDeferredFileSink<AsyncSink>;
+using SyncDeferredFileSink = BasicDeferredFileSink<SyncSink>;
+
 }  // namespace nvlog
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "nvlog/declare.h"
+
+namespace nvlog {
+
+// EmergencyWriter
+//
+// Async-signal-safe writer used while the process is crashing.
+// Only uses a fixed stack buffer and write(2): no allocation, no locks,
+// no locale or stream, so timestamps are written as epoch seconds.
+class EmergencyWriter {
+ public:
+  explicit EmergencyWriter(int fd) : fd_(fd), len_(0) {}
+
+  ~EmergencyWriter() {
+    Flush();
+  }
+
+  EmergencyWriter(const EmergencyWriter&) = delete;
+  EmergencyWriter& operator=(const EmergencyWriter&) = delete;
+
+  void Append(const char* data, size_t size) {
+    while (size > 0) {
+      if (len_ == sizeof(buffer_)) {
+        Flush();
+      }
+      size_t n = std::min(size, sizeof(buffer_) - len_);
+      std::memcpy(buffer_ + len_, data, n);
+      len_ += n;
+      data += n;
+      size -= n;
+    }
+  }
+
+  void Append(const char* str) {
+    Append(str, std::strlen(str));
+  }
+
+  void Append(std::string_view str) {
+    Append(str.data(), str.size());
+  }
+
+  void AppendUint(uint64_t value, int min_width = 0) {
+    char digits[20];
+    int n = 0;
+    do {
+      digits[n++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value > 0);
+    for (; min_width > n; --min_width) {
+      Append("0", 1);
+    }
+    while (n > 0) {
+      Append(&digits[--n], 1);
+    }
+  }
+
+  // Write ```LEVEL [seconds.micros] tid=.. file:line [tag] message```,
+  // ```[ticks=..]``` instead of the time when it is not converted yet
+  void Write(const LogMessage& log_message) {
+    static const char* const kLevels[] = {"TRACE", "DEBUG", "INFO",
+                                          "WARN",  "ERROR", "CRITICAL"};
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  log_message.timestamp.time_since_epoch())
+                  .count();
+    if (us < 0) {
+      us = 0;
+    }
+
+    Append(kLevels[static_cast<int>(log_message.log_level)]);
+    Append(" [");
+    if (us == 0 && log_message.ticks != 0) {
+      // Still queued in tick mode, the channel has not converted it yet
+      Append("ticks=");
+      AppendUint(log_message.ticks);
+    } else {
+      AppendUint(static_cast<uint64_t>(us) / 1000000);
+      Append(".");
+      AppendUint(static_cast<uint64_t>(us) % 1000000, 6);
+    }
+    Append("] tid=");
+    Append(log_message.thread_id);
+    Append(" ");
+    Append(log_message.file);
+    Append(":");
+    AppendUint(static_cast<uint64_t>(log_message.line));
+    Append(" [");
+    Append(log_message.tag);
+    Append("] ");
+    Append(log_message.message);
+    Append("\n", 1);
+  }
+
+  void Flush() {
+    size_t offset = 0;
+    while (offset < len_) {
+      ssize_t n = ::write(fd_, buffer_ + offset, len_ - offset);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      offset += static_cast<size_t>(n);
+    }
+    len_ = 0;
+  }
+
+ private:
+  int fd_;
+  size_t len_;
+  char buffer_[1024];
+};
+
+}  // namespace nvlog
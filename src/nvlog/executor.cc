@@ -0,0 +1,127 @@
+#include "nvlog/executor.h"
+
+namespace nvlog {
+
+namespace {
+// Worker index of the calling thread in ```current_executor```
+thread_local const Executor* current_executor = nullptr;
+thread_local size_t current_index = 0;
+}  // namespace
+
+Executor::Executor(size_t threads, WorkerOptions options)
+                : next_(0), pending_(0), sleeping_(0), stopping_(false) {
+  if (threads == 0) {
+    threads = 1;
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    WorkerOptions worker_options = options;
+    worker_options.name = (options.name.empty() ? std::string("nvlog-exec")
+                                                : options.name) +
+                          "-" + std::to_string(i);
+    if (options.cpu >= 0) {
+      worker_options.cpu = options.cpu + static_cast<int>(i);
+    }
+    threads_.emplace_back(&Executor::Run, this, i, worker_options);
+  }
+}
+
+Executor::~Executor() {
+  Shutdown();
+}
+
+bool Executor::Submit(Task task) {
+  bool internal = current_executor == this;
+  // Counted before ```stopping_``` is read: either a worker sees the task
+  // pending and stays, or the task is refused
+  pending_.fetch_add(1, std::memory_order_seq_cst);
+  if (!internal && stopping_.load(std::memory_order_seq_cst)) {
+    pending_.fetch_sub(1, std::memory_order_seq_cst);
+    return false;
+  }
+  size_t index = internal ? current_index
+                          : next_.fetch_add(1, std::memory_order_relaxed) %
+                                workers_.size();
+  {
+    std::lock_guard<std::mutex> lock(workers_[index]->mu);
+    workers_[index]->tasks.push_back(std::move(task));
+  }
+  if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+    std::lock_guard<std::mutex> lock(idle_mu_);
+    idle_cond_.notify_one();
+  }
+  return true;
+}
+
+void Executor::Shutdown() {
+  if (stopping_.exchange(true, std::memory_order_seq_cst)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(idle_mu_);
+    idle_cond_.notify_all();
+  }
+  for (auto& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+void Executor::Run(size_t index, WorkerOptions options) {
+  ConfigureCurrentThread(options);
+  current_executor = this;
+  current_index = index;
+
+  while (true) {
+    Task task;
+    if (TryPop(index, task) || TrySteal(index, task)) {
+      pending_.fetch_sub(1, std::memory_order_relaxed);
+      task();
+      continue;
+    }
+
+    if (stopping_.load(std::memory_order_seq_cst) &&
+        pending_.load(std::memory_order_seq_cst) == 0) {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(idle_mu_);
+    sleeping_.fetch_add(1, std::memory_order_seq_cst);
+    idle_cond_.wait(lock, [this] {
+      return pending_.load(std::memory_order_seq_cst) > 0 || stopping_.load();
+    });
+    sleeping_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  current_executor = nullptr;
+}
+
+bool Executor::TryPop(size_t index, Task& task) {
+  Worker& worker = *workers_[index];
+  std::lock_guard<std::mutex> lock(worker.mu);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  task = std::move(worker.tasks.front());
+  worker.tasks.pop_front();
+  return true;
+}
+
+// Steal from the back of another worker, away from where it pops
+bool Executor::TrySteal(size_t index, Task& task) {
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker& victim = *workers_[(index + i) % workers_.size()];
+    std::unique_lock<std::mutex> lock(victim.mu, std::try_to_lock);
+    if (!lock.owns_lock() || victim.tasks.empty()) {
+      continue;
+    }
+    task = std::move(victim.tasks.back());
+    victim.tasks.pop_back();
+    return true;
+  }
+  return false;
+}
+
+}  // namespace nvlog
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nvlog/worker_options.h"
+
+namespace nvlog {
+
+// Executor
+//
+// Small work-stealing thread pool shared by sinks, instead of one OS
+// thread per ```AsyncSink```. Each worker has its own task deque, tasks
+// submitted from a worker stay on it, external submissions are spread
+// round-robin, an idle worker steals from the others before sleeping.
+// Tasks run in FIFO order per deque, ordering between tasks is not
+// guaranteed: sinks serialise their own work as a strand.
+class Executor {
+ public:
+  using Task = std::function<void()>;
+
+  // ```options.cpu``` pins worker ```i``` to CPU ```cpu + i```
+  explicit Executor(size_t threads = 1,
+                    WorkerOptions options = WorkerOptions());
+
+  ~Executor();
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  // Return false, without running ```task```, once ```Shutdown``` has
+  // begun. Tasks submitted by the running tasks themselves are still
+  // accepted and run before the workers exit.
+  bool Submit(Task task);
+
+  // Run the remaining tasks and join the workers
+  void Shutdown();
+
+  bool IsStopped() const {
+    return stopping_.load();
+  }
+
+  size_t ThreadCount() const {
+    return threads_.size();
+  }
+
+ private:
+  struct Worker {
+    std::mutex mu;
+    std::deque<Task> tasks;
+  };
+
+  void Run(size_t index, WorkerOptions options);
+  bool TryPop(size_t index, Task& task);
+  bool TrySteal(size_t index, Task& task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_;
+  std::atomic<size_t> pending_;
+  std::atomic<size_t> sleeping_;
+  std::atomic<bool> stopping_;
+  std::mutex idle_mu_;
+  std::condition_variable idle_cond_;
+};
+
+}  // namespace nvlog
@@ -0,0 +1,195 @@
+#include "nvlog/flight_recorder_sink.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <new>
+
+#include "nvlog/formatter.h"
+
+namespace nvlog {
+
+namespace {
+bool IsValidHeader(const FlightRecorderHeader* header, size_t capacity) {
+  if (std::memcmp(header->magic, kFlightRecorderMagic,
+                  sizeof(kFlightRecorderMagic)) != 0 ||
+      header->version != kFlightRecorderVersion ||
+      header->data_offset != kFlightRecorderDataOffset ||
+      header->capacity != capacity) {
+    return false;
+  }
+  uint64_t head = header->head.load();
+  uint64_t tail = header->tail.load();
+  return tail <= head && head - tail <= capacity;
+}
+
+// Padding records are only guaranteed 8 bytes: size, level and kind
+constexpr size_t kPaddingHeaderSize = 8;
+}  // namespace
+
+FlightRecorderSink::FlightRecorderSink(const std::string& filename,
+                                       size_t capacity)
+                : filename_(filename),
+                  capacity_(capacity & ~(kRecordAlign - 1)),
+                  mapped_size_(0),
+                  header_(nullptr),
+                  data_(nullptr) {
+  if (capacity_ < 4096) {
+    capacity_ = 4096;
+  }
+  size_t mapped_size = kFlightRecorderDataOffset + capacity_;
+
+  int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    ReportError("FlightRecorderSink failed to open file: " + filename);
+    return;
+  }
+
+  struct stat st = {};
+  bool reuse = ::fstat(fd, &st) == 0 &&
+               static_cast<size_t>(st.st_size) == mapped_size;
+  if (!reuse && ::ftruncate(fd, static_cast<off_t>(mapped_size)) != 0) {
+    ReportError("FlightRecorderSink failed to resize file: " + filename);
+    ::close(fd);
+    return;
+  }
+
+  void* mapped = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    ReportError("FlightRecorderSink failed to map file: " + filename);
+    return;
+  }
+
+  mapped_size_ = mapped_size;
+  header_ = static_cast<FlightRecorderHeader*>(mapped);
+  data_ = static_cast<char*>(mapped) + kFlightRecorderDataOffset;
+
+  if (!reuse || !IsValidHeader(header_, capacity_)) {
+    new (header_) FlightRecorderHeader();
+    std::memcpy(header_->magic, kFlightRecorderMagic,
+                sizeof(kFlightRecorderMagic));
+    header_->version = kFlightRecorderVersion;
+    header_->data_offset = kFlightRecorderDataOffset;
+    header_->capacity = capacity_;
+    header_->head.store(0);
+    header_->tail.store(0);
+  }
+}
+
+FlightRecorderSink::~FlightRecorderSink() {
+  if (header_) {
+    ::munmap(header_, mapped_size_);
+  }
+}
+
+void FlightRecorderSink::Log(LogMessagePtr log_message) {
+  if (!header_ || !log_message) {
+    return;
+  }
+
+  // Single record never takes more than half of the ring
+  size_t max_message = capacity_ / 2;
+  uint64_t size = EncodedRecordSize(*log_message, max_message);
+  if (size > capacity_ / 2) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  uint64_t offset = head % capacity_;
+  uint64_t padding = capacity_ - offset < size ? capacity_ - offset : 0;
+  Reserve(padding + size);
+
+  if (padding > 0) {
+    RecordHeader pad = {};
+    pad.size = static_cast<uint32_t>(padding);
+    pad.kind = kRecordPadding;
+    std::memcpy(data_ + offset, &pad, kPaddingHeaderSize);
+    head += padding;
+    offset = 0;
+  }
+
+  EncodeRecord(*log_message, data_ + offset, max_message);
+  header_->head.store(head + size, std::memory_order_release);
+  RecordWrite(*log_message, size);
+}
+
+void FlightRecorderSink::Shutdown(bool force) {
+  if (header_) {
+    ::msync(header_, mapped_size_, force ? MS_SYNC : MS_ASYNC);
+  }
+}
+
+// Drop the oldest records until ```size``` bytes are free.
+// Tail is published before the space is overwritten.
+void FlightRecorderSink::Reserve(uint64_t size) {
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+  while (head + size - tail > capacity_) {
+    uint32_t record_size;
+    std::memcpy(&record_size, data_ + tail % capacity_, sizeof(record_size));
+    if (record_size == 0 || record_size > capacity_ - tail % capacity_) {
+      tail = head;  // corrupted ring, start over
+      break;
+    }
+    tail += record_size;
+  }
+  header_->tail.store(tail, std::memory_order_release);
+}
+
+bool ReadFlightRecorder(const std::string& filename,
+                        const std::function<void(const LogMessage&)>& fn) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st = {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) <= kFlightRecorderDataOffset) {
+    ::close(fd);
+    return false;
+  }
+  size_t mapped_size = static_cast<size_t>(st.st_size);
+  void* mapped = ::mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+
+  const auto* header = static_cast<const FlightRecorderHeader*>(mapped);
+  size_t capacity = mapped_size - kFlightRecorderDataOffset;
+  if (!IsValidHeader(header, capacity)) {
+    ::munmap(mapped, mapped_size);
+    return false;
+  }
+
+  const char* data = static_cast<const char*>(mapped) + kFlightRecorderDataOffset;
+  uint64_t head = header->head.load(std::memory_order_acquire);
+  uint64_t position = header->tail.load(std::memory_order_acquire);
+  while (position < head) {
+    size_t offset = position % capacity;
+    RecordHeader record = {};
+    std::memcpy(&record, data + offset, kPaddingHeaderSize);
+    if (record.size == 0 || record.size > capacity - offset) {
+      break;
+    }
+    if (record.kind == kRecordLog) {
+      auto log_message = DecodeRecord(data + offset, capacity - offset);
+      if (!log_message) {
+        break;
+      }
+      fn(*log_message);
+    }
+    position += record.size;
+  }
+
+  ::munmap(mapped, mapped_size);
+  return true;
+}
+
+}  // namespace nvlog
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "nvlog/record_codec.h"
+#include "nvlog/sink.h"
+
+namespace nvlog {
+
+// Header at the start of a flight recorder file.
+// Positions are monotonic byte counters, offset in the data area is
+// ```position % capacity```. Readers trust ```[tail, head)``` only:
+// the writer moves tail past records before overwriting them, and moves
+// head after the record is fully copied, so a process killed mid-write
+// leaves a consistent ring behind.
+struct FlightRecorderHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t data_offset;
+  uint64_t capacity;
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+};
+
+constexpr char kFlightRecorderMagic[8] = {'N', 'V', 'L', 'O',
+                                          'G', 'F', 'R', '1'};
+constexpr uint32_t kFlightRecorderVersion = 1;
+constexpr uint32_t kFlightRecorderDataOffset = 4096;
+
+// FlightRecorderSink
+//
+// Always-on verbose logging at near zero I/O cost.
+// Records are copied in binary form into a fixed-size ```mmap```ed file
+// laid out as a circular buffer, the page cache writes them back, so the
+// last ```capacity``` bytes of logs survive a crash or ```kill -9```.
+// Read the file back with the ```nvlog_dump``` tool.
+//
+// Existing ring with the same capacity is reopened and appended to.
+class FlightRecorderSink : public Sink {
+ public:
+  explicit FlightRecorderSink(const std::string& filename,
+                              size_t capacity = 16 * 1024 * 1024);
+
+  ~FlightRecorderSink();
+
+  void Log(LogMessagePtr log_message) override;
+
+  void Start() override {}
+
+  // Ask the kernel to write the mapping back, the ring stays mapped
+  void Shutdown(bool force = false) override;
+
+  bool IsRun() const override {
+    return header_ != nullptr;
+  }
+
+  bool RendersText() const override {
+    return false;
+  }
+
+  std::string Name() const override {
+    return "flight_recorder:" + filename_;
+  }
+
+ private:
+  void Reserve(uint64_t size);
+
+  std::string filename_;
+  size_t capacity_;
+  size_t mapped_size_;
+  FlightRecorderHeader* header_;
+  char* data_;
+  std::mutex mu_;
+};
+
+// Visit every record of the flight recorder file ```filename```, oldest
+// first. Return false when the file is not a flight recorder ring.
+bool ReadFlightRecorder(const std::string& filename,
+                        const std::function<void(const LogMessage&)>& fn);
+
+}  // namespace nvlog
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <iostream>
 #include <sstream>
 
 #include "nvlog/declare.h"
+#include "nvlog/log_site.h"
 
 namespace nvlog {
 inline void DefaultLevelFormatter(std::ostringstream& buffer,
@@ -39,7 +41,7 @@ inline void DefaultFormatter(std::ostringstream& buffer,
                              const LogMessage& log_message) {
   auto time = log_message.timestamp;
   auto time_t = std::chrono::system_clock::to_time_t(time);
-  auto tm = *std::localtime(&time_t);
+  auto tm = LocalTime(time_t);
   auto ms = std::chrono::duration_cast<std::chrono::microseconds>(
                 time.time_since_epoch()) %
             1000000;
@@ -73,7 +75,7 @@ inline void SimpleFormatter(std::ostringstream& buffer,
                              const nvlog::LogMessage& log_message) {
   auto time = log_message.timestamp;
   auto time_t = std::chrono::system_clock::to_time_t(time);
-  auto tm = *std::localtime(&time_t);
+  auto tm = LocalTime(time_t);
   auto ms = std::chrono::duration_cast<std::chrono::microseconds>(
                 time.time_since_epoch()) %
             1000000;
@@ -98,4 +100,18 @@ inline void SimpleFormatter(std::ostringstream& buffer,
                                std::ios::floatfield)
          << std::setfill('0');
 }
+
+// Report an error of the library itself (a file that cannot be opened, a
+// broken index...) at the call site. Quiet unless built with ```NVLOG_DEBUG```.
+inline void ReportError(const std::string& message,
+                        const char* file = __builtin_FILE(),
+                        int line = __builtin_LINE()) {
+#if NVLOG_DEBUG == 1
+  LogMessage log(std::chrono::system_clock::now(), LogLevel::Error, "nvlog",
+                 message, Basename(file), line, GetThreadId(), nullptr);
+  std::ostringstream ss;
+  DefaultFormatter(ss, log);
+  std::cerr << ss.str() << std::endl;
+#endif
+}
 }  // namespace nvlog
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "nvlog/declare.h"
+#include "nvlog/worker_options.h"
+
+namespace nvlog {
+
+struct LevelThrottleOptions {
+  // Records waiting in the channel queue plus the deepest sink queue.
+  // At or above ```high_watermark``` and not draining, the level is raised
+  // one step; at or below ```low_watermark``` it is lowered one step.
+  size_t high_watermark = 100000;
+  size_t low_watermark = 10000;
+  // Never raised above this level: warnings and errors always get through
+  LogLevel max_level = LogLevel::Info;
+  // Backlog sampling period
+  std::chrono::milliseconds interval = std::chrono::milliseconds(100);
+  // Time spent at a level before it is lowered again
+  std::chrono::milliseconds hold = std::chrono::seconds(2);
+};
+
+// Backlog seen by the throttle at one sampling point
+struct ThrottleSample {
+  uint64_t backlog = 0;   // records queued, see ```LevelThrottleOptions```
+  uint64_t enqueued = 0;  // records accepted by the channel so far
+  uint64_t now_ns = 0;    // steady clock
+};
+
+// LevelThrottle
+//
+// Controller raising the minimum level while the sinks fall behind, so
+// verbosity degrades step by step (Trace, Debug, Info ...) before the
+// queues grow without bound. The level goes up while the backlog is over
+// the high watermark and not shrinking, and comes back down one step per
+// ```hold``` once it is under the low watermark; the gap between the two
+// watermarks and the hold keep it from flapping. ```Evaluate()``` is the
+// whole decision, the thread of ```Start()``` only samples periodically.
+class LevelThrottle {
+ public:
+  explicit LevelThrottle(LevelThrottleOptions options) : options_(options) {}
+
+  ~LevelThrottle() {
+    Stop();
+  }
+
+  // Feed one sample, ```base``` being the logger level. Return true when
+  // the throttle level changes, ```level``` is then the new one (Trace
+  // when the throttle no longer restricts anything).
+  bool Evaluate(const ThrottleSample& sample, LogLevel base,
+                LogLevel& level) {
+    uint64_t elapsed = sample.now_ns - last_.now_ns;
+    // Records that left the queues since the last sample
+    int64_t drained = static_cast<int64_t>(sample.enqueued - last_.enqueued) -
+                      (static_cast<int64_t>(sample.backlog) -
+                       static_cast<int64_t>(last_.backlog));
+    drain_rate_ = elapsed != 0 && drained > 0
+                      ? static_cast<uint64_t>(drained) * 1000000000 / elapsed
+                      : 0;
+    bool shrinking = sample.backlog < last_.backlog;
+    last_ = sample;
+
+    LogLevel effective = level_ > base ? level_ : base;
+    LogLevel next = level_;
+    if (sample.backlog >= options_.high_watermark && !shrinking &&
+        effective < options_.max_level) {
+      next = static_cast<LogLevel>(static_cast<int>(effective) + 1);
+    } else if (sample.backlog <= options_.low_watermark &&
+               level_ != LogLevel::Trace &&
+               sample.now_ns - changed_ns_ >= HoldNs()) {
+      next = static_cast<LogLevel>(static_cast<int>(level_) - 1);
+      if (next <= base) {
+        next = LogLevel::Trace;
+      }
+    }
+    if (next == level_) {
+      return false;
+    }
+    level_ = next;
+    changed_ns_ = sample.now_ns;
+    level = next;
+    return true;
+  }
+
+  LogLevel Level() const {
+    return level_;
+  }
+
+  // Records per second leaving the queues, as of the last sample
+  uint64_t DrainRate() const {
+    return drain_rate_;
+  }
+
+  // Call ```poll``` every ```interval``` on a background thread until
+  // ```Stop()```. The level restarts from Trace.
+  void Start(std::function<void()> poll) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (thread_.joinable()) {
+      return;
+    }
+    level_ = LogLevel::Trace;
+    last_ = ThrottleSample();
+    stop_ = false;
+    thread_ = std::thread([this, poll]() {
+      WorkerOptions options;
+      options.name = "nvlog-throttle";
+      ConfigureCurrentThread(options);
+      std::unique_lock<std::mutex> lock(mu_);
+      while (!cond_.wait_for(lock, options_.interval,
+                             [this]() { return stop_; })) {
+        lock.unlock();
+        poll();
+        lock.lock();
+      }
+    });
+  }
+
+  void Stop() {
+    std::thread thread;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+      thread.swap(thread_);
+    }
+    cond_.notify_all();
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+ private:
+  uint64_t HoldNs() const {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(options_.hold)
+            .count());
+  }
+
+  LevelThrottleOptions options_;
+  // Sampling thread only (or the caller of ```Evaluate```)
+  LogLevel level_ = LogLevel::Trace;
+  ThrottleSample last_;
+  uint64_t changed_ns_ = 0;
+  uint64_t drain_rate_ = 0;
+
+  std::mutex mu_;
+  std::condition_variable cond_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace nvlog
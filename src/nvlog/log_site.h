@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "nvlog/declare.h"
+
+namespace nvlog {
+
+// Return the file name part of ```path```, usable at compile time
+constexpr std::string_view Basename(std::string_view path) {
+  size_t pos = path.find_last_of("/\\");
+  return pos == std::string_view::npos ? path : path.substr(pos + 1);
+}
+
+// LogSite
+//
+// Metadata of one logging call site, a ```static constexpr``` object built
+// by the ```LOG_*``` macros. Records point at it instead of copying the
+// file name and the tag, the text lives in the binary read-only data.
+struct LogSite {
+  std::string_view file;  // basename of ```__FILE__```
+  const char* function;
+  int32_t line;
+  LogLevel level;
+  std::string_view tag;  // literal tag, empty when given at the call
+
+  constexpr LogSite(std::string_view f, const char* fn, int32_t ln,
+                    LogLevel lv, std::string_view tg = std::string_view())
+                  : file(Basename(f)),
+                    function(fn),
+                    line(ln),
+                    level(lv),
+                    tag(tg) {}
+};
+
+// True for the type of a string literal (```decltype((tag))```), also
+// matched by any ```const char[]```: ```NVLOG_SITE_TAG``` checks the text
+// is a constant too
+template <typename T>
+struct IsLiteralTag : std::false_type {};
+
+template <size_t N>
+struct IsLiteralTag<const char (&)[N]> : std::true_type {};
+
+inline LogMessage::LogMessage(std::chrono::system_clock::time_point ts,
+                              const LogSite& s, std::string msg,
+                              std::string tid, void* d)
+                : log_level(s.level),
+                  timestamp(ts),
+                  tag(s.tag),
+                  message(std::move(msg)),
+                  file(s.file),
+                  line(s.line),
+                  thread_id(std::move(tid)),
+                  data(d),
+                  site(&s) {}
+
+}  // namespace nvlog
+
+// Declare the ```static constexpr``` site ```nvlog_site``` of the
+// enclosing call
+#define NVLOG_SITE(level, tag)                                           \
+  static constexpr nvlog::LogSite nvlog_site(__FILE__, __func__, __LINE__, \
+                                             level, tag)
+
+// Tag of a ```LOG_*_T``` call stored in its ```LogSite```: the literal
+// itself, empty for a tag built at runtime. The runtime expression is
+// never evaluated here. Only constant text is kept: a literal or a
+// ```constexpr``` array. Any other array, e.g. an automatic or
+// ```static const char[]```, takes the runtime path.
+#define NVLOG_SITE_TAG(tag)                                   \
+  (nvlog::IsLiteralTag<decltype((tag))>::value &&             \
+           __builtin_constant_p(std::string_view(tag).size()) \
+       ? std::string_view(tag)                                \
+       : std::string_view())
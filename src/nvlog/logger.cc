@@ -5,4 +5,5 @@ namespace nvlog {
 // Define the static member variables
 std::shared_ptr<Logger> Logger::instance_ = nullptr;
 std::mutex Logger::mutex_;
+std::atomic<Logger*> Logger::current_{nullptr};
 }  // namespace nvlog
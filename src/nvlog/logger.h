@@ -3,24 +3,42 @@
 #include <memory>
 
 #include "nvlog/channel.h"
+#include "nvlog/clock.h"
 #include "nvlog/console_sink.h"
 #include "nvlog/declare.h"
+#include "nvlog/level_throttle.h"
 #include "nvlog/limiters/rate_limiter.h"
+#include "nvlog/log_site.h"
+#include "nvlog/tag_registry.h"
 namespace nvlog {
 
 class Logger {
  public:
+  // Called after a ```Fatal``` record is enqueued
+  using FatalHook = void (*)();
+
   explicit Logger(std::shared_ptr<limiters::RateLimiter> rate_limiter)
-                  : channel_(std::make_shared<Channel>(rate_limiter)) {
+                  : channel_(std::make_shared<Channel>(rate_limiter)),
+                    fatal_hook_(nullptr),
+                    latency_metrics_(false),
+                    clock_source_(ClockSource::System),
+                    min_level_(LogLevel::Trace),
+                    throttle_level_(LogLevel::Trace) {
     channel_->Start();
   }
 
   explicit Logger(std::shared_ptr<limiters::RateLimiter> rate_limiter,
                   std::vector<std::shared_ptr<nvlog::Sink>>& sinks)
-                  : channel_(std::make_shared<Channel>(rate_limiter, sinks)) {}
+                  : channel_(std::make_shared<Channel>(rate_limiter, sinks)),
+                    fatal_hook_(nullptr),
+                    latency_metrics_(false),
+                    clock_source_(ClockSource::System),
+                    min_level_(LogLevel::Trace),
+                    throttle_level_(LogLevel::Trace) {}
 
   void StartEngine() {
     channel_->Start();
+    StartThrottle();
   }
 
   bool IsRun() const {
@@ -28,6 +46,10 @@ class Logger {
   }
 
   void ShutdownEngine(bool force = false) {
+    if (throttle_) {
+      throttle_->Stop();
+      throttle_level_.store(LogLevel::Trace, std::memory_order_relaxed);
+    }
     channel_->Shutdown(force);
   }
 
@@ -38,6 +60,7 @@ class Logger {
     if (!instance_) {
       instance_ = std::make_shared<Logger>(
           std::make_shared<limiters::NullLimiter>(), sinks);
+      current_.store(instance_.get(), std::memory_order_release);
     }
   }
 
@@ -46,113 +69,484 @@ class Logger {
     return instance_;
   }
 
-  void Log(LogLevel level, const std::string& message, const std::string& tag,
-           const std::string& file, int line, void* data = nullptr) const {
-    auto log_message = std::make_shared<LogMessage>(
-        std::chrono::system_clock::now(), level, tag, message, file, line,
-        GetThreadId(), data);
-    channel_->Enqueue(log_message);
+  // Registered logger without the lock and the reference count, used by
+  // the macros. Valid until exit, the registered logger is never replaced.
+  static Logger* Current() {
+    return current_.load(std::memory_order_acquire);
+  }
+
+  // ```message``` is moved into the record, tag and file are copied
+  void Log(LogLevel level, std::string message, std::string_view tag,
+           std::string_view file, int line, void* data = nullptr) const {
+    uint32_t tag_id = TagId(tag);
+    if (!Admit(level, tag_id)) {
+      return;
+    }
+    uint64_t start_ns = StartNs();
+    auto log_message = MakeLogMessage(Now(), level, tag, std::move(message),
+                                      file, line, GetThreadId(), data);
+    log_message->tag_id = tag_id;
+    Submit(std::move(log_message), start_ns);
+  }
+
+  // Record of a ```LOG_*``` macro: file, line, level and tag are read from
+  // the static ```site```. ```message``` is anything a ```std::string```
+  // can be built from; an rvalue string is moved, not copied.
+  template <typename Message>
+  void Log(const LogSite& site, Message&& message,
+           void* data = nullptr) const {
+    if (Admit(site.level)) {
+      LogAdmitted(site, std::forward<Message>(message), data);
+    }
+  }
+
+  // Tag given at the call, copied into the record unless it is interned
+  // (see ```LogAdmitted```). A literal tag is only kept in place when it
+  // is part of the ```site```, as the ```LOG_*_T``` macros do.
+  template <typename Message, size_t N>
+  void Log(const LogSite& site, Message&& message, const char (&tag)[N],
+           void* data = nullptr) const {
+    Log(site, std::forward<Message>(message), std::string_view(tag), data);
+  }
+
+  template <typename Message>
+  void Log(const LogSite& site, Message&& message, std::string_view tag,
+           void* data = nullptr) const {
+    uint32_t tag_id = TagId(tag);
+    if (Admit(site.level, tag_id)) {
+      LogAdmitted(site, std::forward<Message>(message), tag, tag_id, data);
+    }
+  }
+
+  // ```make_message()``` is only called once the record is admitted, an
+  // expensive dump costs nothing when filtered or rate limited
+  template <typename Fn>
+  void LogLazy(const LogSite& site, Fn&& make_message,
+               void* data = nullptr) const {
+    if (Admit(site.level)) {
+      LogAdmitted(site, make_message(), data);
+    }
+  }
+
+  // Logger level (or the level of ```tag_id``` when set, see
+  // ```SetTagLevel```), throttle level and rate limiter, checked first on
+  // every logging call: a refused record reads no clock, formats no thread
+  // id and allocates nothing. A true return takes a limiter token, the
+  // record must then be logged with ```LogAdmitted```.
+  bool Admit(LogLevel level, uint32_t tag_id = kUnresolvedTagId) const {
+    if (level < tag_levels_.MinLevel(
+                    tag_id, min_level_.load(std::memory_order_relaxed)) ||
+        level < throttle_level_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    if (channel_->AllowRate()) {
+      return true;
+    }
+    if (level == LogLevel::Fatal) {
+      RunFatalHook();
+    }
+    return false;
+  }
+
+  // Same as ```Log```, for a record that already passed ```Admit()```
+  template <typename Message>
+  void LogAdmitted(const LogSite& site, Message&& message,
+                   void* data = nullptr) const {
+    uint64_t start_ns = StartNs();
+    Submit(MakeLogMessage(Now(), site,
+                          std::string(std::forward<Message>(message)),
+                          GetThreadId(), data),
+           start_ns);
+  }
+
+  // Literal tag of ```site``` already resolved to ```tag_id```, so the
+  // channel does not look it up again for the tag filters
+  template <typename Message>
+  void LogAdmitted(const LogSite& site, Message&& message, uint32_t tag_id,
+                   void* data = nullptr) const {
+    uint64_t start_ns = StartNs();
+    auto log_message =
+        MakeLogMessage(Now(), site, std::string(std::forward<Message>(message)),
+                       GetThreadId(), data);
+    log_message->tag_id = tag_id;
+    Submit(std::move(log_message), start_ns);
+  }
+
+  // Character arrays, e.g. a buffer on the stack, are copied
+  template <typename Message, size_t N>
+  void LogAdmitted(const LogSite& site, Message&& message,
+                   const char (&tag)[N], uint32_t tag_id = kUnresolvedTagId,
+                   void* data = nullptr) const {
+    LogAdmitted(site, std::forward<Message>(message), std::string_view(tag),
+                tag_id, data);
   }
 
+  // ```tag_id``` as returned by ```TagId```: a resolved tag is viewed in
+  // the registry instead of being copied
+  template <typename Message>
+  void LogAdmitted(const LogSite& site, Message&& message,
+                   std::string_view tag, uint32_t tag_id = kUnresolvedTagId,
+                   void* data = nullptr) const {
+    uint64_t start_ns = StartNs();
+    auto log_message =
+        MakeLogMessage(Now(), site, std::string(std::forward<Message>(message)),
+                       GetThreadId(), data);
+    if (tag_id != kUnresolvedTagId) {
+      log_message->tag = TagRegistry::Instance().NameView(tag_id);
+      log_message->tag_id = tag_id;
+    } else {
+      log_message->Own(tag, site.file);
+    }
+    Submit(std::move(log_message), start_ns);
+  }
+
+  // Tag ID of the literal tag of ```site```, interned once and cached in
+  // ```cache```
+  uint32_t TagId(std::atomic<uint32_t>& cache, const LogSite& site) const {
+    return ResolveTag(cache, site.tag);
+  }
+
+  // Tag ID of a runtime tag, only looked up while some tag has its own
+  // level and never interned: a tag without an ID has no level of its
+  // own, ```kUnresolvedTagId``` then means inherit.
+  uint32_t TagId(std::string_view tag) const {
+    return tag_levels_.Any() ? TagRegistry::Instance().Find(tag)
+                             : kUnresolvedTagId;
+  }
+
+  // Records below ```min_level``` are dropped before anything is built,
+  // sinks filter further with their own level. Can be changed any time.
+  void SetLevel(LogLevel min_level) {
+    min_level_.store(min_level, std::memory_order_relaxed);
+  }
+
+  LogLevel GetLevel() const {
+    return min_level_.load(std::memory_order_relaxed);
+  }
+
+  // Level of the records tagged ```tag```, in place of the logger level,
+  // e.g. ```DB``` at Debug and ```HTTP``` at Warning while the logger is
+  // at Info. Checked in the macros before the message is built, at the
+  // cost of one more relaxed load. Can be changed any time. Return false
+  // past ```TagLevels::kCapacity``` distinct tags.
+  bool SetTagLevel(std::string_view tag, LogLevel min_level) {
+    return tag_levels_.Set(TagRegistry::Instance().Intern(tag), min_level);
+  }
+
+  // Records tagged ```tag``` follow the logger level again
+  void ClearTagLevel(std::string_view tag) {
+    uint32_t tag_id = TagRegistry::Instance().Find(tag);
+    if (tag_id != kUnresolvedTagId) {
+      tag_levels_.Clear(tag_id);
+    }
+  }
+
+  // Record built elsewhere, e.g. decoded by ```nvlogd``` from the shared
+  // memory ring, passed on as is
+  void Forward(LogMessagePtr log_message) const {
+    if (channel_->AllowRate()) {
+      channel_->Enqueue(std::move(log_message));
+    }
+  }
+
+  // Sinks can be added and removed while logging, producers never wait
+  // for the change. Sink levels, tag filters and formatters can be changed
+  // the same way on the sink itself.
   void AddSink(std::shared_ptr<Sink> sink) {
     channel_->AddSink(sink);
   }
 
+  bool RemoveSink(const std::shared_ptr<Sink>& sink) {
+    return channel_->RemoveSink(sink);
+  }
+
+  // Keep Trace/Debug records in memory and only log them when an error
+  // occurs. Must be called before ```StartEngine()```.
+  void EnableBacktrace(BacktraceOptions options = BacktraceOptions()) {
+    channel_->EnableBacktrace(options);
+  }
+
+  // Let Error/Fatal records overtake queued Trace/Debug ones in the
+  // channel queue, see ```LaneOptions```. Sinks have their own queue, set
+  // it with ```AsyncSink::SetPriorityLanes```. Must be called before
+  // ```StartEngine()```.
+  void SetPriorityLanes(LaneOptions options = LaneOptions()) {
+    channel_->SetPriorityLanes(options);
+  }
+
+  // Bound the memory held by logging: records beyond the budget are shed
+  // (lowest levels first) or make the producer wait, see
+  // ```MemoryBudgetOptions```. Must be called before ```StartEngine()```.
+  void SetMemoryBudget(MemoryBudgetOptions options = MemoryBudgetOptions()) {
+    channel_->SetMemoryBudget(options);
+  }
+
+  // Raise the minimum level while the sinks fall behind and restore it
+  // once they caught up, see ```LevelThrottle```. Every change is logged
+  // as a Warning tagged ```nvlog```. On a running engine the previous
+  // throttle thread is stopped before it is replaced and the level
+  // restarts from Trace. Not thread safe against ```StartEngine()``` or
+  // ```ShutdownEngine()```.
+  void SetLevelThrottle(
+      LevelThrottleOptions options = LevelThrottleOptions()) {
+    if (throttle_) {
+      throttle_->Stop();
+      throttle_level_.store(LogLevel::Trace, std::memory_order_relaxed);
+    }
+    throttle_ = std::make_unique<LevelThrottle>(options);
+    if (IsRun()) {
+      StartThrottle();
+    }
+  }
+
+  // Level raised by the throttle, Trace when it restricts nothing
+  LogLevel GetThrottleLevel() const {
+    return throttle_level_.load(std::memory_order_relaxed);
+  }
+
+  // Wait strategy, CPU affinity and name of the channel worker thread,
+  // see ```AsyncSink::SetWorkerOptions``` for the sink workers.
+  // Must be called before ```StartEngine()```.
+  void SetWorkerOptions(WorkerOptions options) {
+    channel_->SetWorkerOptions(options);
+  }
+
+  // Select where record timestamps come from, must be called before
+  // ```StartEngine()```. ```ClockSource::Tsc``` is refused (return false)
+  // when the CPU has no invariant TSC.
+  bool SetClockSource(ClockSource source) {
+    if (source == ClockSource::Tsc) {
+      if (!TicksAreInvariant()) {
+        return false;
+      }
+      channel_->EnableTickClock();
+    }
+    clock_source_.store(source, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Record producer ```Log()``` latency and enqueue to write latency of
+  // each sink. Costs two steady clock reads per record, off by default.
+  void EnableLatencyMetrics(bool enable = true) {
+    latency_metrics_.store(enable, std::memory_order_relaxed);
+  }
+
+  // Snapshot of the logger counters, see ```LoggerStats::ToText()```
+  LoggerStats GetStats() const {
+    return channel_->GetStats();
+  }
+
+  void SetFatalHook(FatalHook hook) {
+    fatal_hook_.store(hook);
+  }
+
+  // Wait until every record logged so far is written and the sink
+  // buffers are flushed, without stopping the engine. Return false when
+  // ```timeout``` expires first, see ```Channel::Sync```.
+  bool Sync(std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+    return channel_->Sync(timeout);
+  }
+
+  // Crash path, write every pending record with async-signal-safe calls.
+  // See ```CrashHandler```.
+  void EmergencyDrain(int fallback_fd) {
+    channel_->EmergencyDrain(fallback_fd);
+  }
+
  private:
+  uint64_t StartNs() const {
+    return latency_metrics_.load(std::memory_order_relaxed) ? SteadyNowNs()
+                                                            : 0;
+  }
+
+  // Timestamp of a new record, left empty for the channel to convert
+  // when ticks are used
+  std::chrono::system_clock::time_point Now() const {
+    return clock_source_.load(std::memory_order_relaxed) == ClockSource::Tsc
+               ? std::chrono::system_clock::time_point()
+               : std::chrono::system_clock::now();
+  }
+
+  void Submit(LogMessagePtr log_message, uint64_t start_ns) const {
+    LogLevel level = log_message->log_level;
+    if (clock_source_.load(std::memory_order_relaxed) == ClockSource::Tsc) {
+      log_message->ticks = ReadTicks();
+    }
+    log_message->enqueue_ns = start_ns;
+    channel_->Enqueue(std::move(log_message));
+    if (start_ns != 0) {
+      channel_->Metrics().log_latency.Record(SteadyNowNs() - start_ns);
+    }
+    if (level == LogLevel::Fatal) {
+      RunFatalHook();
+    }
+  }
+
+  void StartThrottle() {
+    if (throttle_) {
+      throttle_->Start([this]() { PollThrottle(); });
+    }
+  }
+
+  // Throttle thread. The change record bypasses the levels and the rate
+  // limiter, so the degradation is always visible in the logs.
+  void PollThrottle() {
+    ThrottleSample sample = channel_->SampleBacklog();
+    sample.now_ns = SteadyNowNs();
+    LogLevel level;
+    if (!throttle_->Evaluate(sample, GetLevel(), level)) {
+      return;
+    }
+    throttle_level_.store(level, std::memory_order_relaxed);
+    std::string message =
+        level == LogLevel::Trace
+            ? std::string("Log level restored to ") + LevelName(GetLevel())
+            : std::string("Log level throttled to ") + LevelName(level);
+    message += ": backlog " + std::to_string(sample.backlog) +
+               " records, draining " + std::to_string(throttle_->DrainRate()) +
+               " records/s";
+    Submit(MakeLogMessage(Now(), LogLevel::Warning, "nvlog",
+                          std::move(message), __FILE__, __LINE__,
+                          GetThreadId()),
+           0);
+  }
+
+  void RunFatalHook() const {
+    FatalHook hook = fatal_hook_.load();
+    if (hook) {
+      hook();
+    }
+  }
+
   std::shared_ptr<Channel> channel_;
+  std::atomic<FatalHook> fatal_hook_;
+  std::atomic<bool> latency_metrics_;
+  std::atomic<ClockSource> clock_source_;
+  std::atomic<LogLevel> min_level_;
+  std::atomic<LogLevel> throttle_level_;
+  TagLevels tag_levels_;
+  std::unique_ptr<LevelThrottle> throttle_;
   static std::shared_ptr<Logger> instance_;
+  static std::atomic<Logger*> current_;
   static std::mutex mutex_;
 };
 
-#define LOG_TRACE(message)                                                 \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Trace, message, "", __FILE__, \
-                            __LINE__);
+// Every macro records through a ```static constexpr``` ```LogSite```. The
+// message expression is only evaluated once the record is admitted.
+#define NVLOG_LOG(level, message)                                 \
+  {                                                               \
+    NVLOG_SITE(level, "");                                        \
+    const nvlog::Logger* nvlog_logger = nvlog::Logger::Current(); \
+    if (nvlog_logger->Admit(level)) {                             \
+      nvlog_logger->LogAdmitted(nvlog_site, message);             \
+    }                                                             \
+  }
+
+// A string literal ```tag``` is stored in the site, referenced in place
+// and interned once per call site for the per-tag level check. Any other
+// tag (```std::string```, ```char``` buffer ...) is evaluated once and
+// copied into the record.
+#define NVLOG_LOG_T(level, message, log_tag)                               \
+  {                                                                        \
+    NVLOG_SITE(level, NVLOG_SITE_TAG(log_tag));                            \
+    static std::atomic<uint32_t> nvlog_tag_cache(nvlog::kUnresolvedTagId); \
+    const nvlog::Logger* nvlog_logger = nvlog::Logger::Current();          \
+    if (!nvlog_site.tag.empty()) {                                         \
+      uint32_t nvlog_tag_id =                                              \
+          nvlog_logger->TagId(nvlog_tag_cache, nvlog_site);                \
+      if (nvlog_logger->Admit(level, nvlog_tag_id)) {                      \
+        nvlog_logger->LogAdmitted(nvlog_site, message, nvlog_tag_id);      \
+      }                                                                    \
+    } else {                                                               \
+      const auto& nvlog_tag = log_tag;                                     \
+      uint32_t nvlog_tag_id = nvlog_logger->TagId(nvlog_tag);              \
+      if (nvlog_logger->Admit(level, nvlog_tag_id)) {                      \
+        nvlog_logger->LogAdmitted(nvlog_site, message,                     \
+                                  std::string_view(nvlog_tag),             \
+                                  nvlog_tag_id);                           \
+      }                                                                    \
+    }                                                                      \
+  }
+
+// Message returned by a callable, e.g. ```[&] { return Dump(state); }```,
+// only invoked once the record is admitted
+#define NVLOG_LOG_L(level, ...)                                 \
+  {                                                             \
+    NVLOG_SITE(level, "");                                      \
+    nvlog::Logger::Current()->LogLazy(nvlog_site, __VA_ARGS__); \
+  }
+
+#define LOG_TRACE(message) NVLOG_LOG(nvlog::LogLevel::Trace, message)
+
+#define LOG_DEBUG(message) NVLOG_LOG(nvlog::LogLevel::Debug, message)
 
-#define LOG_DEBUG(message)                                                 \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Debug, message, "", __FILE__, \
-                            __LINE__);
+#define LOG_INFO(message) NVLOG_LOG(nvlog::LogLevel::Info, message)
 
-#define LOG_INFO(message)                                                 \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Info, message, "", __FILE__, \
-                            __LINE__);
+#define LOG_WARN(message) NVLOG_LOG(nvlog::LogLevel::Warning, message)
 
-#define LOG_WARN(message)                                                    \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Warning, message, "", __FILE__, \
-                            __LINE__);
+#define LOG_ERROR(message) NVLOG_LOG(nvlog::LogLevel::Error, message)
 
-#define LOG_ERROR(message)                                                 \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Error, message, "", __FILE__, \
-                            __LINE__);
+#define LOG_FATAL(message) NVLOG_LOG(nvlog::LogLevel::Fatal, message)
 
-#define LOG_FATAL(message)                                                 \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Fatal, message, "", __FILE__, \
-                            __LINE__);
+#define LOG_TRACE_T(message, tag) \
+  NVLOG_LOG_T(nvlog::LogLevel::Trace, message, tag)
 
-// LOG Trace with tag
-#define LOG_TRACE_T(message, tag)                                           \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Trace, message, tag, __FILE__, \
-                            __LINE__);
+#define LOG_DEBUG_T(message, tag) \
+  NVLOG_LOG_T(nvlog::LogLevel::Debug, message, tag)
 
-// Log Debug with tag
-#define LOG_DEBUG_T(message, tag)                                           \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Debug, message, tag, __FILE__, \
-                            __LINE__);
+#define LOG_INFO_T(message, tag) \
+  NVLOG_LOG_T(nvlog::LogLevel::Info, message, tag)
 
-#define LOG_INFO_T(message, tag)                                           \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Info, message, tag, __FILE__, \
-                            __LINE__);
+#define LOG_WARN_T(message, tag) \
+  NVLOG_LOG_T(nvlog::LogLevel::Warning, message, tag)
 
-#define LOG_WARN_T(message, tag)                                              \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Warning, message, tag, __FILE__, \
-                            __LINE__);
+#define LOG_ERROR_T(message, tag) \
+  NVLOG_LOG_T(nvlog::LogLevel::Error, message, tag)
 
-#define LOG_ERROR_T(message, tag)                                           \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Error, message, tag, __FILE__, \
-                            __LINE__);
+#define LOG_FATAL_T(message, tag) \
+  NVLOG_LOG_T(nvlog::LogLevel::Fatal, message, tag)
 
-#define LOG_FATAL_T(message, tag)                                           \
-  nvlog::Logger::Get()->Log(nvlog::LogLevel::Fatal, message, tag, __FILE__, \
-                            __LINE__);
+#define LOG_TRACE_L(...) NVLOG_LOG_L(nvlog::LogLevel::Trace, __VA_ARGS__)
 
-// LOG Trace with tag
-#define LOG_TRACE_COND_T(statement, message, tag)                             \
-  if (statement) {                                                            \
-    nvlog::Logger::Get()->Log(nvlog::LogLevel::Trace, message, tag, __FILE__, \
-                              __LINE__);                                      \
+#define LOG_DEBUG_L(...) NVLOG_LOG_L(nvlog::LogLevel::Debug, __VA_ARGS__)
+
+#define LOG_INFO_L(...) NVLOG_LOG_L(nvlog::LogLevel::Info, __VA_ARGS__)
+
+#define LOG_WARN_L(...) NVLOG_LOG_L(nvlog::LogLevel::Warning, __VA_ARGS__)
+
+#define LOG_ERROR_L(...) NVLOG_LOG_L(nvlog::LogLevel::Error, __VA_ARGS__)
+
+#define LOG_FATAL_L(...) NVLOG_LOG_L(nvlog::LogLevel::Fatal, __VA_ARGS__)
+
+// Log with tag when ```statement``` is true
+#define LOG_TRACE_COND_T(statement, message, tag)     \
+  if (statement) {                                    \
+    NVLOG_LOG_T(nvlog::LogLevel::Trace, message, tag) \
   }
 
-// LOG Info with tag
-#define LOG_INFO_COND_T(statement, message, tag)                             \
-  if (statement) {                                                           \
-    nvlog::Logger::Get()->Log(nvlog::LogLevel::Info, message, tag, __FILE__, \
-                              __LINE__);                                     \
+#define LOG_DEBUG_COND_T(statement, message, tag)     \
+  if (statement) {                                    \
+    NVLOG_LOG_T(nvlog::LogLevel::Debug, message, tag) \
   }
 
-// LOG Debug with tag
-#define LOG_DEBUG_COND_T(statement, message, tag)                             \
-  if (statement) {                                                            \
-    nvlog::Logger::Get()->Log(nvlog::LogLevel::Debug, message, tag, __FILE__, \
-                              __LINE__);                                      \
+#define LOG_INFO_COND_T(statement, message, tag)     \
+  if (statement) {                                   \
+    NVLOG_LOG_T(nvlog::LogLevel::Info, message, tag) \
   }
 
-// LOG Warning with tag
-#define LOG_WARN_COND_T(statement, message, tag)                      \
-  if (statement) {                                                    \
-    nvlog::Logger::Get()->Log(nvlog::LogLevel::Warning, message, tag, \
-                              __FILE__, __LINE__);                    \
+#define LOG_WARN_COND_T(statement, message, tag)        \
+  if (statement) {                                      \
+    NVLOG_LOG_T(nvlog::LogLevel::Warning, message, tag) \
   }
 
-// LOG Error with tag
-#define LOG_ERROR_COND_T(statement, message, tag)                             \
-  if (statement) {                                                            \
-    nvlog::Logger::Get()->Log(nvlog::LogLevel::Error, message, tag, __FILE__, \
-                              __LINE__);                                      \
+#define LOG_ERROR_COND_T(statement, message, tag)     \
+  if (statement) {                                    \
+    NVLOG_LOG_T(nvlog::LogLevel::Error, message, tag) \
   }
 
-// LOG Fatal with tag
-#define LOG_FATAL_COND_T(statement, message, tag)                             \
-  if (statement) {                                                            \
-    nvlog::Logger::Get()->Log(nvlog::LogLevel::Fatal, message, tag, __FILE__, \
-                              __LINE__);                                      \
+#define LOG_FATAL_COND_T(statement, message, tag)     \
+  if (statement) {                                    \
+    NVLOG_LOG_T(nvlog::LogLevel::Fatal, message, tag) \
   }
+
 }  // namespace nvlog
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "nvlog/declare.h"
+
+namespace nvlog {
+
+// What a producer does when its record does not fit in the budget
+enum class BudgetPolicy {
+  Shed,   // drop the record, counted in ```LoggerStats::budget_shed```
+  Block,  // wait for the sinks to free memory, up to ```max_block```
+};
+
+struct MemoryBudgetOptions {
+  // Records in flight plus sink buffers, in bytes
+  size_t limit_bytes = 64 * 1024 * 1024;
+  BudgetPolicy policy = BudgetPolicy::Shed;
+  // Records below ```keep_level``` only get ```low_ratio``` of the limit,
+  // the rest stays free for warnings and errors during a flood
+  LogLevel keep_level = LogLevel::Warning;
+  double low_ratio = 0.75;
+  // ```BudgetPolicy::Block``` waits at most this long, then sheds: a
+  // producer is never stuck on a sink that stopped writing
+  std::chrono::microseconds max_block = std::chrono::milliseconds(100);
+};
+
+// MemoryBudget
+//
+// Cap on the memory held by logging. Every record is charged its payload
+// bytes when the channel admits it and released when its last owner frees
+// it; buffering sinks charge their write buffers to the same counter.
+// Admission is one relaxed fetch_add, undone when over the limit. A record
+// larger than the whole budget is still admitted when nothing else is in
+// flight, so logging never stalls for good.
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(MemoryBudgetOptions options)
+                  : options_(options),
+                    low_limit_(static_cast<uint64_t>(
+                        static_cast<double>(options.limit_bytes) *
+                        options.low_ratio)) {}
+
+  // Charge ```log_message``` or return false when it has to be shed
+  bool Admit(LogMessage& log_message) {
+    uint64_t bytes = log_message.PayloadBytes();
+    uint64_t limit = log_message.log_level >= options_.keep_level
+                         ? options_.limit_bytes
+                         : low_limit_;
+    if (!TryAcquire(bytes, limit)) {
+      if (options_.policy != BudgetPolicy::Block || !Wait(bytes, limit)) {
+        return false;
+      }
+    }
+    log_message.budget = &counter_;
+    log_message.charged = static_cast<uint32_t>(bytes);
+    return true;
+  }
+
+  // Sink buffers, never refused: the record they come from was admitted
+  void Charge(uint64_t bytes) {
+    counter_.Add(bytes);
+  }
+
+  void Release(uint64_t bytes) {
+    counter_.Sub(bytes);
+  }
+
+  uint64_t Bytes() const {
+    return counter_.bytes.load(std::memory_order_relaxed);
+  }
+
+  uint64_t HighWater() const {
+    return counter_.high_water.load(std::memory_order_relaxed);
+  }
+
+  uint64_t Limit() const {
+    return options_.limit_bytes;
+  }
+
+ private:
+  bool TryAcquire(uint64_t bytes, uint64_t limit) {
+    uint64_t before = counter_.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (before == 0 || before + bytes <= limit) {
+      counter_.Raise(before + bytes);
+      return true;
+    }
+    counter_.Sub(bytes);
+    return false;
+  }
+
+  // Backpressure: poll with a growing sleep, sinks free memory in batches
+  bool Wait(uint64_t bytes, uint64_t limit) {
+    auto deadline = std::chrono::steady_clock::now() + options_.max_block;
+    std::chrono::microseconds pause(1);
+    while (std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(pause);
+      if (TryAcquire(bytes, limit)) {
+        return true;
+      }
+      pause = std::min(pause * 2, std::chrono::microseconds(200));
+    }
+    return false;
+  }
+
+  MemoryBudgetOptions options_;
+  uint64_t low_limit_;
+  BudgetCounter counter_;
+};
+
+}  // namespace nvlog
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nvlog {
+
+// Return steady clock now in nanoseconds, used by latency metrics
+inline uint64_t SteadyNowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+// ShardedCounter
+//
+// Counter incremented by many producer threads. Each thread hits its own
+// cache line, so counting costs no cross-core traffic on the hot path,
+// reading sums the shards.
+class ShardedCounter {
+ public:
+  static constexpr size_t kShards = 16;
+
+  void Add(uint64_t n = 1) {
+    shards_[ShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t Load() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+      total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value{0};
+  };
+
+  static size_t ShardIndex() {
+    static thread_local size_t index =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % kShards;
+    return index;
+  }
+
+  Shard shards_[kShards];
+};
+
+// Point in time copy of a ```LatencyHistogram```
+struct HistogramSnapshot {
+  std::vector<uint64_t> counts;  // per bucket, see LatencyHistogram
+  uint64_t count = 0;
+  uint64_t sum = 0;  // of the recorded values, ns
+
+  // Return upper bound (ns) of the bucket holding the ```q``` quantile
+  uint64_t Quantile(double q) const;
+};
+
+// LatencyHistogram
+//
+// Log-linear histogram of nanosecond latencies: every power of two range
+// is split into 4 linear sub-buckets, so the error is at most 25% over the
+// whole 64-bit range with 252 buckets. Record is two relaxed fetch_add
+// (bucket and exact sum), lock-free and safe from any thread.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 2;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  void Record(uint64_t ns) {
+    buckets_[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  HistogramSnapshot Snapshot() const {
+    HistogramSnapshot snapshot;
+    snapshot.counts.resize(kBuckets);
+    for (int i = 0; i < kBuckets; ++i) {
+      snapshot.counts[i] = buckets_[i].load(std::memory_order_relaxed);
+      snapshot.count += snapshot.counts[i];
+    }
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    return snapshot;
+  }
+
+  static int BucketIndex(uint64_t value) {
+    if (value < static_cast<uint64_t>(kSubBuckets)) {
+      return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int sub = static_cast<int>((value >> (msb - kSubBucketBits)) &
+                               (kSubBuckets - 1));
+    return (msb - kSubBucketBits + 1) * kSubBuckets + sub;
+  }
+
+  // Return the largest value falling into bucket ```index```
+  static uint64_t BucketUpperBound(int index) {
+    if (index < kSubBuckets) {
+      return static_cast<uint64_t>(index);
+    }
+    int msb = index / kSubBuckets + kSubBucketBits - 1;
+    uint64_t sub = static_cast<uint64_t>(index % kSubBuckets);
+    int shift = msb - kSubBucketBits;
+    uint64_t lower = (static_cast<uint64_t>(kSubBuckets) + sub) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+  }
+
+ private:
+  std::atomic<uint64_t> buckets_[kBuckets] = {};
+  std::atomic<uint64_t> sum_{0};
+};
+
+inline uint64_t HistogramSnapshot::Quantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count));
+  if (rank >= count) {
+    rank = count - 1;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    seen += counts[i];
+    if (seen > rank) {
+      return LatencyHistogram::BucketUpperBound(static_cast<int>(i));
+    }
+  }
+  return LatencyHistogram::BucketUpperBound(
+      static_cast<int>(counts.size()) - 1);
+}
+
+// Counters owned by each sink
+struct SinkMetrics {
+  std::atomic<uint64_t> processed{0};
+  std::atomic<uint64_t> bytes_written{0};
+  LatencyHistogram write_latency;  // enqueue to write, when enabled
+};
+
+// Counters owned by the channel
+struct ChannelMetrics {
+  ShardedCounter enqueued;
+  ShardedCounter rate_limited;
+  ShardedCounter dropped;
+  ShardedCounter budget_shed;  // refused by the ```MemoryBudget```
+  LatencyHistogram log_latency;  // producer ```Logger::Log```, when enabled
+};
+
+struct SinkStats {
+  std::string name;
+  uint64_t processed = 0;
+  uint64_t bytes_written = 0;
+  uint64_t queue_depth = 0;
+  HistogramSnapshot write_latency;
+};
+
+// LoggerStats
+//
+// Snapshot returned by ```Logger::GetStats()```, cheap enough to scrape
+// every second. ```ToText()``` renders it in the Prometheus text
+// exposition format to be served from the application own endpoint.
+struct LoggerStats {
+  uint64_t enqueued = 0;
+  uint64_t dropped = 0;
+  uint64_t rate_limited = 0;
+  uint64_t queue_depth = 0;
+  uint64_t budget_limit = 0;  // 0 without a memory budget
+  uint64_t budget_bytes = 0;
+  uint64_t budget_high_water = 0;
+  uint64_t budget_shed = 0;
+  HistogramSnapshot log_latency;
+  std::vector<SinkStats> sinks;
+
+  std::string ToText() const {
+    std::ostringstream ss;
+    ss << "# TYPE nvlog_enqueued_total counter\n"
+       << "nvlog_enqueued_total " << enqueued << '\n'
+       << "# TYPE nvlog_dropped_total counter\n"
+       << "nvlog_dropped_total " << dropped << '\n'
+       << "# TYPE nvlog_rate_limited_total counter\n"
+       << "nvlog_rate_limited_total " << rate_limited << '\n'
+       << "# TYPE nvlog_queue_depth gauge\n"
+       << "nvlog_queue_depth " << queue_depth << '\n';
+    if (budget_limit != 0) {
+      ss << "# TYPE nvlog_budget_limit_bytes gauge\n"
+         << "nvlog_budget_limit_bytes " << budget_limit << '\n'
+         << "# TYPE nvlog_budget_bytes gauge\n"
+         << "nvlog_budget_bytes " << budget_bytes << '\n'
+         << "# TYPE nvlog_budget_high_water_bytes gauge\n"
+         << "nvlog_budget_high_water_bytes " << budget_high_water << '\n'
+         << "# TYPE nvlog_budget_shed_total counter\n"
+         << "nvlog_budget_shed_total " << budget_shed << '\n';
+    }
+    WriteHistogram(ss, "nvlog_log_latency_ns", "", log_latency);
+
+    ss << "# TYPE nvlog_sink_processed_total counter\n";
+    for (size_t i = 0; i < sinks.size(); ++i) {
+      ss << "nvlog_sink_processed_total" << SinkLabels(i) << ' '
+         << sinks[i].processed << '\n';
+    }
+    ss << "# TYPE nvlog_sink_bytes_total counter\n";
+    for (size_t i = 0; i < sinks.size(); ++i) {
+      ss << "nvlog_sink_bytes_total" << SinkLabels(i) << ' '
+         << sinks[i].bytes_written << '\n';
+    }
+    ss << "# TYPE nvlog_sink_queue_depth gauge\n";
+    for (size_t i = 0; i < sinks.size(); ++i) {
+      ss << "nvlog_sink_queue_depth" << SinkLabels(i) << ' '
+         << sinks[i].queue_depth << '\n';
+    }
+    for (size_t i = 0; i < sinks.size(); ++i) {
+      WriteHistogram(ss, "nvlog_sink_write_latency_ns", LabelBody(i),
+                     sinks[i].write_latency, i == 0);
+    }
+    return ss.str();
+  }
+
+ private:
+  std::string LabelBody(size_t index) const {
+    return "sink=\"" + std::to_string(index) + "\",name=\"" +
+           EscapeLabel(sinks[index].name) + "\"";
+  }
+
+  // Label values are quoted: backslash, quote and newline are escaped,
+  // e.g. in the name of a ```unix:``` sink built from a path
+  static std::string EscapeLabel(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+      if (c == '\\' || c == '"') {
+        escaped += '\\';
+        escaped += c;
+      } else if (c == '\n') {
+        escaped += "\\n";
+      } else {
+        escaped += c;
+      }
+    }
+    return escaped;
+  }
+
+  std::string SinkLabels(size_t index) const {
+    return "{" + LabelBody(index) + "}";
+  }
+
+  // Buckets up to the highest non-empty one, cumulative as Prometheus expects
+  static void WriteHistogram(std::ostringstream& ss, const std::string& name,
+                             const std::string& labels,
+                             const HistogramSnapshot& histogram,
+                             bool write_type = true) {
+    if (write_type) {
+      ss << "# TYPE " << name << " histogram\n";
+    }
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    int last = -1;
+    for (size_t i = 0; i < histogram.counts.size(); ++i) {
+      if (histogram.counts[i] != 0) {
+        last = static_cast<int>(i);
+      }
+    }
+    uint64_t cumulative = 0;
+    for (int i = 0; i <= last; ++i) {
+      cumulative += histogram.counts[i];
+      ss << name << "_bucket{" << prefix << "le=\""
+         << LatencyHistogram::BucketUpperBound(i) << "\"} " << cumulative
+         << '\n';
+    }
+    ss << name << "_bucket{" << prefix << "le=\"+Inf\"} " << histogram.count
+       << '\n';
+    std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+    ss << name << "_sum" << suffix << ' ' << histogram.sum << '\n';
+    ss << name << "_count" << suffix << ' ' << histogram.count << '\n';
+  }
+};
+
+}  // namespace nvlog
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "nvlog/worker_options.h"
+
+namespace nvlog {
+
+// MpscQueue
+//
+// Unbounded lock-free multi-producer single-consumer queue
+// (Vyukov node based). Enqueue is one exchange and one store, never blocks
+// and never takes a lock. Dequeue must only be called by one consumer.
+// Size is counted on the producer cache line, read by the consumer.
+// ```TryForEach``` holds the consumer off while it walks, the consumer
+// pays one fenced store per dequeue for it.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue()
+                  : enqueued_(0), dequeued_(0), dequeuing_(false),
+                    paused_(false) {
+    Node* stub = new Node();
+    head_.store(stub, std::memory_order_relaxed);
+    tail_ = stub;
+  }
+
+  ~MpscQueue() {
+    Node* node = tail_;
+    while (node) {
+      Node* next = node->next.load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  void Enqueue(T value) {
+    Node* node = new Node(std::move(value));
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+    enqueued_.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  // Consumer only. May return false for a short moment while a producer is
+  // between its exchange and its link, or while ```TryForEach``` walks,
+  // even though ```Size()``` is not 0.
+  bool TryDequeue(T& value) {
+    dequeuing_.store(true, std::memory_order_seq_cst);
+    if (paused_.load(std::memory_order_seq_cst)) {
+      dequeuing_.store(false, std::memory_order_release);
+      return false;
+    }
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      value = std::move(next->value);
+      tail_ = next;
+      delete tail;
+      dequeued_.store(dequeued_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+    }
+    dequeuing_.store(false, std::memory_order_release);
+    return next != nullptr;
+  }
+
+  size_t Size() const {
+    uint64_t enqueued = enqueued_.load(std::memory_order_seq_cst);
+    uint64_t dequeued = dequeued_.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? static_cast<size_t>(enqueued - dequeued) : 0;
+  }
+
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+  // Visit queued items in order without removing them, for the crash path:
+  // no lock, no allocation. The consumer is held off until the walk is done
+  // so no visited node is freed under it. Give up, visiting nothing, when
+  // the consumer does not leave ```TryDequeue``` in time (e.g. the caller
+  // interrupted it). One walker at a time.
+  template <typename Fn>
+  bool TryForEach(Fn fn) const {
+    paused_.store(true, std::memory_order_seq_cst);
+    uint32_t spins = 0;
+    while (dequeuing_.load(std::memory_order_seq_cst)) {
+      if (++spins == kPauseSpins) {
+        paused_.store(false, std::memory_order_release);
+        return false;
+      }
+      CpuRelax();
+    }
+    Node* node = tail_->next.load(std::memory_order_acquire);
+    while (node) {
+      fn(node->value);
+      node = node->next.load(std::memory_order_acquire);
+    }
+    paused_.store(false, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  static constexpr uint32_t kPauseSpins = 1u << 16;
+
+  struct Node {
+    Node() : next(nullptr) {}
+    explicit Node(T v) : next(nullptr), value(std::move(v)) {}
+
+    std::atomic<Node*> next;
+    T value;
+  };
+
+  // Producer side
+  alignas(64) std::atomic<Node*> head_;
+  std::atomic<uint64_t> enqueued_;
+  // Consumer side
+  alignas(64) Node* tail_;
+  std::atomic<uint64_t> dequeued_;
+  std::atomic<bool> dequeuing_;
+  // Set by ```TryForEach```
+  mutable std::atomic<bool> paused_;
+};
+
+}  // namespace nvlog
@@ -1,14 +1,31 @@
 #include "nvlog/declare.h"
+#include "nvlog/log_site.h"
 #include "nvlog/util.h"
+#include "nvlog/clock.h"
+#include "nvlog/rcu.h"
+#include "nvlog/tag_registry.h"
+#include "nvlog/sink_filter.h"
 #include "nvlog/limiters/rate_limiter.h"
 #include "nvlog/limiters/token_bucket_rate_limiter.h"
 #include "nvlog/concurrent_queue.h"
+#include "nvlog/mpsc_queue.h"
+#include "nvlog/worker_options.h"
+#include "nvlog/work_queue.h"
+#include "nvlog/executor.h"
+#include "nvlog/metrics.h"
+#include "nvlog/backtrace.h"
 #include "nvlog/formatter.h"
 #include "nvlog/sink.h"
 #include "nvlog/console_sink.h"
+#include "nvlog/time_index.h"
 #include "defered_file_sink.h"
+#include "nvlog/binary_file_sink.h"
+#include "nvlog/flight_recorder_sink.h"
+#include "nvlog/unix_socket_sink.h"
+#include "nvlog/shm_ring.h"
 #include "nvlog/channel.h"
 #include "nvlog/logger.h"
+#include "nvlog/crash_handler.h"
 
 
 
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nvlog/declare.h"
+#include "nvlog/mpsc_queue.h"
+
+namespace nvlog {
+
+// Severity classes of ```PriorityLanes```, drained in this order
+enum class Lane { High, Normal, Low };
+
+// How the worker picks the next lane
+enum class LaneDrain {
+  // Always the highest non-empty lane: an error never waits behind a
+  // debug record, a lower lane may starve while a higher one floods
+  Strict,
+  // Round robin taking up to ```weights``` records from each lane, every
+  // lane keeps moving
+  Weighted,
+};
+
+// Ordering kept inside a lane
+enum class LaneOrder {
+  // One queue per lane: records of a lane leave in enqueue order
+  Fifo,
+  // One queue per producer shard: order is only kept per thread, producers
+  // flooding the same lane mostly stop sharing the queue head
+  PerProducer,
+};
+
+struct LaneOptions {
+  LaneDrain drain = LaneDrain::Strict;
+  LaneOrder order = LaneOrder::Fifo;
+  LogLevel high_from = LogLevel::Error;  // Error, Fatal
+  LogLevel normal_from = LogLevel::Info;  // Info, Warning; below is Low
+  uint32_t weights[3] = {16, 4, 1};  // High, Normal, Low for Weighted
+};
+
+// PriorityLanes
+//
+// Queue store of a ```WorkQueue``` keeping one MPSC queue per severity
+// class, so a record overtakes the lower classes queued before it. Until
+// ```Configure()``` it is a single FIFO queue. A null marker (end of
+// work, sync point) is a barrier: it is queued in every lane and shard and
+// dequeued once, after every record queued before it, whatever the drain
+// policy and the producer shards.
+class PriorityLanes {
+ public:
+  static constexpr size_t kLanes = 3;
+  static constexpr size_t kShards = 8;
+
+  PriorityLanes() {
+    lanes_.resize(1);
+    lanes_[0].shards.push_back(std::make_unique<Queue>());
+    lanes_[0].barriers.resize(1);
+  }
+
+  // Must be called while empty, before the worker and producers start
+  void Configure(LaneOptions options) {
+    options_ = options;
+    enabled_ = true;
+    size_t shards = options.order == LaneOrder::PerProducer ? kShards : 1;
+    lanes_.clear();
+    lanes_.resize(kLanes);
+    for (size_t i = 0; i < kLanes; ++i) {
+      for (size_t s = 0; s < shards; ++s) {
+        lanes_[i].shards.push_back(std::make_unique<Queue>());
+      }
+      lanes_[i].barriers.resize(shards);
+      lanes_[i].weight = std::max<uint32_t>(options.weights[i], 1);
+    }
+    current_ = 0;
+    credit_ = lanes_[0].weight;
+    barriers_ = 0;
+  }
+
+  bool Enabled() const {
+    return enabled_;
+  }
+
+  void Enqueue(LogMessagePtr log_message) {
+    if (!log_message) {
+      EnqueueBarrier();
+      return;
+    }
+    LaneQueues& lane = lanes_[enabled_ ? LaneIndex(log_message) : 0];
+    size_t shard = lane.shards.size() == 1 ? 0 : ShardIndex();
+    lane.shards[shard]->Enqueue(std::move(log_message));
+  }
+
+  // Consumer only. A barrier is returned as one null, once its marker
+  // left every queue.
+  bool TryDequeue(LogMessagePtr& log_message) {
+    size_t lane;
+    size_t shard;
+    while (TryNext(log_message, lane, shard)) {
+      if (log_message) {
+        return true;
+      }
+      ++lanes_[lane].barriers[shard];
+      if (Passed()) {
+        ++barriers_;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t Size() const {
+    size_t size = 0;
+    for (const auto& lane : lanes_) {
+      for (const auto& shard : lane.shards) {
+        size += shard->Size();
+      }
+    }
+    return size;
+  }
+
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+  // Lane by lane, in priority order
+  template <typename Fn>
+  bool TryForEach(Fn fn) const {
+    for (const auto& lane : lanes_) {
+      for (const auto& shard : lane.shards) {
+        shard->TryForEach(fn);
+      }
+    }
+    return true;
+  }
+
+ private:
+  using Queue = MpscQueue<LogMessagePtr>;
+
+  struct LaneQueues {
+    std::vector<std::unique_ptr<Queue>> shards;
+    std::vector<uint64_t> barriers;  // markers dequeued per shard, consumer
+    uint32_t weight = 1;
+    size_t next_shard = 0;  // consumer only
+  };
+
+  // Barriers are queued whole under a lock, so the n-th marker of every
+  // queue belongs to the same barrier
+  void EnqueueBarrier() {
+    std::lock_guard<std::mutex> lock(barrier_mu_);
+    for (auto& lane : lanes_) {
+      for (auto& shard : lane.shards) {
+        shard->Enqueue(nullptr);
+      }
+    }
+  }
+
+  // Every queue dequeued the marker of the next barrier
+  bool Passed() const {
+    for (const auto& lane : lanes_) {
+      for (uint64_t barriers : lane.barriers) {
+        if (barriers <= barriers_) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool TryNext(LogMessagePtr& log_message, size_t& lane, size_t& shard) {
+    if (!enabled_ || options_.drain == LaneDrain::Strict) {
+      for (lane = 0; lane < lanes_.size(); ++lane) {
+        if (TryLane(lanes_[lane], log_message, shard)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Weighted round robin, an empty lane hands its turn to the next one
+    for (size_t tried = 0; tried <= kLanes; ++tried) {
+      if (credit_ != 0 && TryLane(lanes_[current_], log_message, shard)) {
+        --credit_;
+        lane = current_;
+        return true;
+      }
+      current_ = (current_ + 1) % kLanes;
+      credit_ = lanes_[current_].weight;
+    }
+    return false;
+  }
+
+  size_t LaneIndex(const LogMessagePtr& log_message) const {
+    if (log_message->log_level >= options_.high_from) {
+      return static_cast<size_t>(Lane::High);
+    }
+    if (log_message->log_level >= options_.normal_from) {
+      return static_cast<size_t>(Lane::Normal);
+    }
+    return static_cast<size_t>(Lane::Low);
+  }
+
+  // Shards are visited round robin so one producer can't starve the others
+  static bool TryLane(LaneQueues& lane, LogMessagePtr& log_message,
+                      size_t& shard) {
+    size_t shards = lane.shards.size();
+    if (shards == 1) {
+      shard = 0;
+      return lane.shards[0]->TryDequeue(log_message);
+    }
+    for (size_t i = 0; i < shards; ++i) {
+      shard = (lane.next_shard + i) % shards;
+      if (lane.shards[shard]->TryDequeue(log_message)) {
+        lane.next_shard = (shard + 1) % shards;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static size_t ShardIndex() {
+    static thread_local size_t index =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % kShards;
+    return index;
+  }
+
+  std::vector<LaneQueues> lanes_;
+  LaneOptions options_;
+  bool enabled_ = false;
+  size_t current_ = 0;  // consumer only, weighted drain
+  uint32_t credit_ = 0;
+  uint64_t barriers_ = 0;  // consumer only, barriers dequeued
+  std::mutex barrier_mu_;
+};
+
+}  // namespace nvlog
@@ -0,0 +1,70 @@
+#include "nvlog/rcu.h"
+
+#include <thread>
+
+namespace nvlog {
+
+RcuDomain& RcuDomain::Instance() {
+  static RcuDomain* instance = new RcuDomain();
+  return *instance;
+}
+
+// Reuse the slot of an exited thread, or push a new one
+RcuDomain::Reader* RcuDomain::Acquire() {
+  for (Reader* reader = readers_.load(std::memory_order_acquire); reader;
+       reader = reader->next) {
+    if (!reader->in_use.load(std::memory_order_relaxed) &&
+        !reader->in_use.exchange(true, std::memory_order_acquire)) {
+      reader->depth = 0;
+      return reader;
+    }
+  }
+
+  Reader* reader = new Reader();
+  Reader* head = readers_.load(std::memory_order_relaxed);
+  do {
+    reader->next = head;
+  } while (!readers_.compare_exchange_weak(head, reader,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+  return reader;
+}
+
+void RcuDomain::Synchronize() {
+  // A read section of the calling thread can't end while it waits: it is
+  // skipped, and what was retired stays queued since it may still use it
+  Reader* self = Local();
+  std::vector<std::function<void()>> retired;
+  if (self->depth == 0) {
+    std::lock_guard<std::mutex> lock(retired_mu_);
+    retired.swap(retired_);
+  }
+
+  uint64_t target = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+  for (Reader* reader = readers_.load(std::memory_order_acquire); reader;
+       reader = reader->next) {
+    while (reader != self) {
+      uint64_t epoch = reader->epoch.load(std::memory_order_seq_cst);
+      if (epoch == 0 || epoch >= target) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  for (auto& deleter : retired) {
+    deleter();
+  }
+}
+
+void RcuDomain::Retire(std::function<void()> deleter) {
+  if (Local()->depth != 0) {
+    std::lock_guard<std::mutex> lock(retired_mu_);
+    retired_.push_back(std::move(deleter));
+    return;
+  }
+  Synchronize();
+  deleter();
+}
+
+}  // namespace nvlog
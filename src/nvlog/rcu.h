@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nvlog {
+
+// RcuDomain
+//
+// Epoch based reclamation for configuration read on every record and
+// changed rarely. Readers mark the epoch they entered in a per-thread
+// slot, two stores and no lock, and never wait. A writer publishes a new
+// immutable object, then waits for every reader that entered before the
+// publication (grace period) before freeing the old one.
+class RcuDomain {
+ public:
+  // Never destroyed: threads may still log while statics are torn down
+  static RcuDomain& Instance();
+
+  // Read side, nestable. Objects loaded from an ```RcuPtr``` stay valid
+  // until the matching ```Exit()```.
+  void Enter() {
+    Reader* reader = Local();
+    if (reader->depth++ == 0) {
+      reader->epoch.store(epoch_.load(std::memory_order_acquire),
+                          std::memory_order_seq_cst);
+    }
+  }
+
+  void Exit() {
+    Reader* reader = Local();
+    if (--reader->depth == 0) {
+      reader->epoch.store(0, std::memory_order_release);
+    }
+  }
+
+  // Wait until every read section entered before the call has ended,
+  // except one of the calling thread
+  void Synchronize();
+
+  // Run ```deleter``` once no reader can hold what it frees. Called from
+  // inside a read section (a sink reconfiguring the logger) it can't wait
+  // for itself, the deleter then runs at the next grace period.
+  void Retire(std::function<void()> deleter);
+
+ private:
+  struct alignas(64) Reader {
+    std::atomic<uint64_t> epoch{0};  // 0 outside read sections
+    std::atomic<bool> in_use{true};
+    uint32_t depth = 0;  // owner thread only
+    Reader* next = nullptr;
+  };
+
+  // Slot of the current thread, handed back to the domain at thread exit
+  struct LocalReader {
+    Reader* reader = nullptr;
+    ~LocalReader() {
+      if (reader) {
+        reader->epoch.store(0, std::memory_order_release);
+        reader->in_use.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  RcuDomain() : epoch_(1), readers_(nullptr) {}
+
+  Reader* Local() {
+    static thread_local LocalReader local;
+    if (!local.reader) {
+      local.reader = Acquire();
+    }
+    return local.reader;
+  }
+
+  Reader* Acquire();
+
+  std::atomic<uint64_t> epoch_;
+  std::atomic<Reader*> readers_;  // never shrinks, slots are reused
+  std::mutex retired_mu_;
+  std::vector<std::function<void()>> retired_;
+};
+
+// Scoped read section of ```RcuDomain```
+class RcuReadGuard {
+ public:
+  RcuReadGuard() {
+    RcuDomain::Instance().Enter();
+  }
+
+  ~RcuReadGuard() {
+    RcuDomain::Instance().Exit();
+  }
+
+  RcuReadGuard(const RcuReadGuard&) = delete;
+  RcuReadGuard& operator=(const RcuReadGuard&) = delete;
+};
+
+// RcuPtr
+//
+// Pointer to an immutable ```T``` replaced as a whole. ```Load()``` is a
+// single atomic load, valid inside an ```RcuReadGuard```; writers are
+// serialized and free the previous value after a grace period.
+template <typename T>
+class RcuPtr {
+ public:
+  explicit RcuPtr(std::unique_ptr<T> value) : current_(value.release()) {}
+
+  ~RcuPtr() {
+    delete current_.load();
+  }
+
+  RcuPtr(const RcuPtr&) = delete;
+  RcuPtr& operator=(const RcuPtr&) = delete;
+
+  const T* Load() const {
+    return current_.load(std::memory_order_seq_cst);
+  }
+
+  void Store(std::unique_ptr<T> value) {
+    T* previous;
+    {
+      std::lock_guard<std::mutex> lock(write_mu_);
+      previous = current_.exchange(value.release(), std::memory_order_seq_cst);
+    }
+    Retire(previous);
+  }
+
+  // Copy the current value, let ```fn``` change the copy and publish it.
+  // Concurrent updates are applied one after the other, none is lost.
+  template <typename Fn>
+  void Update(Fn fn) {
+    T* previous;
+    {
+      std::lock_guard<std::mutex> lock(write_mu_);
+      auto next = std::make_unique<T>(*current_.load());
+      fn(*next);
+      previous = current_.exchange(next.release(), std::memory_order_seq_cst);
+    }
+    Retire(previous);
+  }
+
+ private:
+  // Outside the write lock: a reader waited for may be about to update
+  static void Retire(T* previous) {
+    RcuDomain::Instance().Retire([previous]() { delete previous; });
+  }
+
+  std::atomic<T*> current_;
+  std::mutex write_mu_;
+};
+
+}  // namespace nvlog
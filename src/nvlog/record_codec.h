@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "nvlog/declare.h"
+
+namespace nvlog {
+
+// Binary record layout shared by the binary sinks and their readers.
+// Fixed header followed by tag, file, thread id and message bytes,
+// total size padded to 8 bytes. Host byte order, records are meant to
+// be read back on the same machine.
+struct RecordHeader {
+  uint32_t size;  // total record size including header and padding
+  uint8_t level;
+  uint8_t kind;
+  uint16_t tag_len;
+  int64_t timestamp_ns;  // system_clock since epoch
+  int32_t line;
+  uint16_t file_len;
+  uint16_t thread_id_len;
+  uint32_t message_len;
+  uint32_t reserved;
+};
+
+enum RecordKind : uint8_t { kRecordLog = 1, kRecordPadding = 2 };
+
+constexpr size_t kRecordAlign = 8;
+
+constexpr size_t AlignRecord(size_t size) {
+  return (size + kRecordAlign - 1) & ~(kRecordAlign - 1);
+}
+
+// Return the encoded size of ```log_message``` once ```message``` is
+// truncated to ```max_message``` bytes
+inline size_t EncodedRecordSize(const LogMessage& log_message,
+                                size_t max_message = UINT32_MAX) {
+  size_t tag = std::min<size_t>(log_message.tag.size(), UINT16_MAX);
+  size_t file = std::min<size_t>(log_message.file.size(), UINT16_MAX);
+  size_t tid = std::min<size_t>(log_message.thread_id.size(), UINT16_MAX);
+  size_t msg = std::min<size_t>(log_message.message.size(), max_message);
+  return AlignRecord(sizeof(RecordHeader) + tag + file + tid + msg);
+}
+
+// Encode ```log_message``` into ```out```, which must hold
+// ```EncodedRecordSize(log_message, max_message)``` bytes.
+// Return the number of bytes written.
+inline size_t EncodeRecord(const LogMessage& log_message, char* out,
+                           size_t max_message = UINT32_MAX) {
+  RecordHeader header = {};
+  header.tag_len =
+      static_cast<uint16_t>(std::min<size_t>(log_message.tag.size(), UINT16_MAX));
+  header.file_len = static_cast<uint16_t>(
+      std::min<size_t>(log_message.file.size(), UINT16_MAX));
+  header.thread_id_len = static_cast<uint16_t>(
+      std::min<size_t>(log_message.thread_id.size(), UINT16_MAX));
+  header.message_len = static_cast<uint32_t>(
+      std::min<size_t>(log_message.message.size(), max_message));
+  header.size = static_cast<uint32_t>(
+      EncodedRecordSize(log_message, max_message));
+  header.level = static_cast<uint8_t>(log_message.log_level);
+  header.kind = kRecordLog;
+  header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            log_message.timestamp.time_since_epoch())
+                            .count();
+  header.line = log_message.line;
+
+  char* p = out;
+  std::memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+  std::memcpy(p, log_message.tag.data(), header.tag_len);
+  p += header.tag_len;
+  std::memcpy(p, log_message.file.data(), header.file_len);
+  p += header.file_len;
+  std::memcpy(p, log_message.thread_id.data(), header.thread_id_len);
+  p += header.thread_id_len;
+  std::memcpy(p, log_message.message.data(), header.message_len);
+  p += header.message_len;
+
+  size_t written = static_cast<size_t>(p - out);
+  std::memset(p, 0, header.size - written);
+  return header.size;
+}
+
+// Decode one log record of at most ```size``` bytes.
+// Return nullptr when the bytes are not a valid log record.
+inline LogMessagePtr DecodeRecord(const char* data, size_t size) {
+  if (size < sizeof(RecordHeader)) {
+    return nullptr;
+  }
+  RecordHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  size_t payload = static_cast<size_t>(header.tag_len) + header.file_len +
+                   header.thread_id_len + header.message_len;
+  if (header.kind != kRecordLog || header.size > size ||
+      sizeof(header) + payload > header.size ||
+      header.level > static_cast<uint8_t>(LogLevel::Fatal)) {
+    return nullptr;
+  }
+
+  const char* p = data + sizeof(header);
+  std::string tag(p, header.tag_len);
+  p += header.tag_len;
+  std::string file(p, header.file_len);
+  p += header.file_len;
+  std::string thread_id(p, header.thread_id_len);
+  p += header.thread_id_len;
+  std::string message(p, header.message_len);
+
+  std::chrono::system_clock::time_point timestamp(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(header.timestamp_ns)));
+  return MakeLogMessage(
+      timestamp, static_cast<LogLevel>(header.level), std::move(tag),
+      std::move(message), std::move(file), header.line, std::move(thread_id));
+}
+
+}  // namespace nvlog
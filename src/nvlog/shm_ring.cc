@@ -0,0 +1,361 @@
+#include "nvlog/shm_ring.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "nvlog/formatter.h"
+
+namespace nvlog {
+
+namespace {
+uint32_t Checksum(const char* data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+constexpr uint64_t State(uint64_t position, ShmSlotStage stage) {
+  return position * 4 + stage;
+}
+
+bool IsValidHeader(const ShmRingHeader* header, size_t mapped_size) {
+  return std::memcmp(header->magic, kShmRingMagic, sizeof(kShmRingMagic)) ==
+             0 &&
+         header->version == kShmRingVersion &&
+         header->slot_size > sizeof(ShmSlot) && header->slots > 0 &&
+         kShmRingDataOffset + header->slots * header->slot_size ==
+             mapped_size;
+}
+
+// Process-shared futex, the word lives in the shared mapping
+void FutexWait(std::atomic<uint32_t>* word, uint32_t value,
+               std::chrono::milliseconds timeout) {
+  timespec ts;
+  ts.tv_sec = timeout.count() / 1000;
+  ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, value,
+            &ts, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word) {
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1,
+            nullptr, nullptr, 0);
+}
+}  // namespace
+
+ShmRing::ShmRing(ShmRingHeader* header, size_t mapped_size)
+                : header_(header),
+                  mapped_size_(mapped_size),
+                  abandon_timeout_(ShmRingOptions().abandon_timeout),
+                  stuck_position_(UINT64_MAX),
+                  abandoned_(0),
+                  corrupted_(0) {}
+
+ShmRing::~ShmRing() {
+  ::munmap(header_, mapped_size_);
+}
+
+std::unique_ptr<ShmRing> ShmRing::Create(const std::string& name,
+                                         ShmRingOptions options) {
+  auto ring = Map(name, true, options);
+  if (ring) {
+    ring->abandon_timeout_ = options.abandon_timeout;
+  }
+  return ring;
+}
+
+std::unique_ptr<ShmRing> ShmRing::Open(const std::string& name) {
+  return Map(name, false, ShmRingOptions());
+}
+
+void ShmRing::Unlink(const std::string& name) {
+  ::shm_unlink(name.c_str());
+}
+
+std::unique_ptr<ShmRing> ShmRing::Map(const std::string& name, bool create,
+                                      const ShmRingOptions& options) {
+  int fd = ::shm_open(name.c_str(), O_RDWR | (create ? O_CREAT : 0), 0660);
+  if (fd < 0) {
+    if (create) {
+      ReportError("ShmRing failed to open shared memory: " + name);
+    }
+    return nullptr;
+  }
+
+  struct stat st = {};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  size_t slot_size = (std::max<size_t>(options.slot_size, 128) + 63) & ~63ul;
+  size_t slots = std::max<size_t>(options.slots, 1);
+  size_t mapped_size = static_cast<size_t>(st.st_size);
+  bool fresh = false;
+  if (create && mapped_size == 0) {
+    mapped_size = kShmRingDataOffset + slots * slot_size;
+    if (::ftruncate(fd, static_cast<off_t>(mapped_size)) != 0) {
+      ReportError("ShmRing failed to size shared memory: " + name);
+      ::close(fd);
+      return nullptr;
+    }
+    fresh = true;
+  }
+  if (mapped_size <= kShmRingDataOffset) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  void* mapped = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return nullptr;
+  }
+  auto* header = static_cast<ShmRingHeader*>(mapped);
+
+  if (fresh) {
+    // Magic is written last, publishers attaching meanwhile refuse the ring
+    new (header) ShmRingHeader();
+    header->version = kShmRingVersion;
+    header->slot_size = static_cast<uint32_t>(slot_size);
+    header->slots = slots;
+    header->head.store(0);
+    header->tail.store(0);
+    header->wake.store(0);
+    header->waiting.store(0);
+    header->full.store(0);
+    char* data = static_cast<char*>(mapped) + kShmRingDataOffset;
+    for (size_t i = 0; i < slots; ++i) {
+      auto* slot = new (data + i * slot_size) ShmSlot();
+      slot->state.store(State(i, kShmSlotFree));
+      slot->pid.store(0);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, kShmRingMagic, sizeof(kShmRingMagic));
+  } else if (!IsValidHeader(header, mapped_size) ||
+             (create && (header->slot_size != slot_size ||
+                         header->slots != slots))) {
+    if (create) {
+      ReportError("ShmRing exists with another layout, unlink it first: " +
+                  name);
+    }
+    ::munmap(mapped, mapped_size);
+    return nullptr;
+  }
+
+  return std::unique_ptr<ShmRing>(new ShmRing(header, mapped_size));
+}
+
+ShmSlot* ShmRing::SlotAt(uint64_t position) const {
+  char* data = reinterpret_cast<char*>(header_) + kShmRingDataOffset;
+  return reinterpret_cast<ShmSlot*>(
+      data + (position % header_->slots) * header_->slot_size);
+}
+
+bool ShmRing::Publish(const LogMessage& log_message) {
+  size_t payload = header_->slot_size - sizeof(ShmSlot);
+  size_t fixed = sizeof(RecordHeader) +
+                 std::min<size_t>(log_message.tag.size(), UINT16_MAX) +
+                 std::min<size_t>(log_message.file.size(), UINT16_MAX) +
+                 std::min<size_t>(log_message.thread_id.size(), UINT16_MAX);
+  if (fixed + kRecordAlign > payload) {
+    return false;
+  }
+  size_t max_message = payload - fixed - (kRecordAlign - 1);
+
+  // Claim a position whose slot is free for it
+  uint64_t position = header_->head.load(std::memory_order_relaxed);
+  ShmSlot* slot;
+  while (true) {
+    slot = SlotAt(position);
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    uint64_t free_state = State(position, kShmSlotFree);
+    if (state == free_state) {
+      if (header_->head.compare_exchange_weak(position, position + 1,
+                                              std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (state < free_state) {
+      // Slot still holds the record of the previous lap
+      header_->full.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = header_->head.load(std::memory_order_relaxed);
+    }
+  }
+
+  // Each transition is a CAS: a consumer that took the slot back from a
+  // publisher it believed dead makes the late publisher give up here.
+  // The pid is only written once the slot is ours, a publisher losing the
+  // CAS must not overwrite the pid of the one owning the slot.
+  uint64_t expected = State(position, kShmSlotFree);
+  if (!slot->state.compare_exchange_strong(
+          expected, State(position, kShmSlotWriting),
+          std::memory_order_acq_rel)) {
+    return false;
+  }
+  slot->pid.store(::getpid(), std::memory_order_relaxed);
+
+  char* data = reinterpret_cast<char*>(slot + 1);
+  size_t size = EncodeRecord(log_message, data, max_message);
+  slot->size = static_cast<uint32_t>(size);
+  slot->checksum = Checksum(data, size);
+
+  expected = State(position, kShmSlotWriting);
+  if (!slot->state.compare_exchange_strong(expected,
+                                           State(position, kShmSlotReady),
+                                           std::memory_order_seq_cst)) {
+    return false;
+  }
+  if (header_->waiting.load(std::memory_order_seq_cst)) {
+    header_->wake.fetch_add(1, std::memory_order_seq_cst);
+    FutexWake(&header_->wake);
+  }
+  return true;
+}
+
+size_t ShmRing::Consume(const std::function<void(LogMessagePtr)>& fn,
+                        size_t max) {
+  size_t payload = header_->slot_size - sizeof(ShmSlot);
+  std::vector<char> record(payload);
+  uint64_t position = header_->tail.load(std::memory_order_relaxed);
+  size_t count = 0;
+
+  while (count < max) {
+    ShmSlot* slot = SlotAt(position);
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    if (state == State(position, kShmSlotReady)) {
+      // Copy out first, the checked bytes are the decoded bytes
+      uint32_t size = std::min<uint32_t>(slot->size, payload);
+      uint32_t checksum = slot->checksum;
+      int32_t pid = slot->pid.load(std::memory_order_relaxed);
+      std::memcpy(record.data(), slot + 1, size);
+      slot->pid.store(0, std::memory_order_relaxed);
+      slot->state.store(State(position + header_->slots, kShmSlotFree),
+                        std::memory_order_release);
+
+      LogMessagePtr log_message;
+      if (Checksum(record.data(), size) == checksum) {
+        log_message = DecodeRecord(record.data(), size);
+      }
+      if (log_message) {
+        // Thread ids are only unique within a process
+        log_message->thread_id =
+            std::to_string(pid) + "/" + log_message->thread_id;
+        fn(std::move(log_message));
+      } else {
+        ++corrupted_;
+      }
+    } else if (position >= header_->head.load(std::memory_order_acquire) ||
+               !TryAbandon(slot, position, state)) {
+      break;
+    }
+
+    ++position;
+    ++count;
+    header_->tail.store(position, std::memory_order_release);
+  }
+  return count;
+}
+
+bool ShmRing::TryAbandon(ShmSlot* slot, uint64_t position, uint64_t state) {
+  if (state != State(position, kShmSlotFree) &&
+      state != State(position, kShmSlotWriting)) {
+    return false;
+  }
+
+  // 0 until the publisher that won the slot stores its pid: a slot
+  // caught in between only goes by the timeout
+  int32_t pid = slot->pid.load(std::memory_order_relaxed);
+  bool dead = false;
+  if (state == State(position, kShmSlotWriting)) {
+    dead = pid > 0 && ::kill(pid, 0) != 0 && errno == ESRCH;
+  }
+  if (!dead) {
+    auto now = std::chrono::steady_clock::now();
+    if (stuck_position_ != position) {
+      stuck_position_ = position;
+      stuck_since_ = now;
+      return false;
+    }
+    if (now - stuck_since_ < abandon_timeout_) {
+      return false;
+    }
+  }
+
+  if (!slot->state.compare_exchange_strong(
+          state, State(position + header_->slots, kShmSlotFree),
+          std::memory_order_acq_rel)) {
+    return false;  // published meanwhile
+  }
+  // Free again: clear the pid unless the publisher of the next lap
+  // already stored its own
+  slot->pid.compare_exchange_strong(pid, 0, std::memory_order_relaxed);
+  ++abandoned_;
+  return true;
+}
+
+void ShmRing::Wait(std::chrono::milliseconds timeout) {
+  header_->waiting.store(1, std::memory_order_seq_cst);
+  uint32_t wake = header_->wake.load(std::memory_order_seq_cst);
+  uint64_t position = header_->tail.load(std::memory_order_relaxed);
+  if (SlotAt(position)->state.load(std::memory_order_seq_cst) !=
+      State(position, kShmSlotReady)) {
+    FutexWait(&header_->wake, wake, timeout);
+  }
+  header_->waiting.store(0, std::memory_order_relaxed);
+}
+
+ShmRingSink::ShmRingSink(const std::string& name)
+                : name_(name),
+                  owned_(ShmRing::Open(name)),
+                  ring_(owned_.get()),
+                  next_open_(std::chrono::steady_clock::now() +
+                             std::chrono::seconds(1)),
+                  dropped_(0) {}
+
+void ShmRingSink::Log(LogMessagePtr log_message) {
+  ShmRing* ring = Ring();
+  if (!ring || !ring->Publish(*log_message)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  RecordWrite(*log_message, EncodedRecordSize(*log_message));
+}
+
+// Ring of a daemon started after this process, looked up once a second
+ShmRing* ShmRingSink::Ring() {
+  ShmRing* ring = ring_.load(std::memory_order_acquire);
+  if (ring) {
+    return ring;
+  }
+  std::unique_lock<std::mutex> lock(open_mu_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return nullptr;
+  }
+  ring = ring_.load(std::memory_order_acquire);
+  auto now = std::chrono::steady_clock::now();
+  if (ring || now < next_open_) {
+    return ring;
+  }
+  next_open_ = now + std::chrono::seconds(1);
+  owned_ = ShmRing::Open(name_);
+  ring_.store(owned_.get(), std::memory_order_release);
+  return owned_.get();
+}
+
+}  // namespace nvlog
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "nvlog/record_codec.h"
+#include "nvlog/sink.h"
+
+namespace nvlog {
+
+// Header at the start of the shared memory ring.
+// ```head``` counts slots claimed by publishers, ```tail``` slots released
+// by the consumer. The futex word ```wake``` is bumped by a publisher only
+// while the consumer announced it sleeps in ```waiting```.
+struct ShmRingHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t slot_size;
+  uint64_t slots;
+  alignas(64) std::atomic<uint64_t> head;
+  alignas(64) std::atomic<uint64_t> tail;
+  alignas(64) std::atomic<uint32_t> wake;
+  std::atomic<uint32_t> waiting;
+  std::atomic<uint64_t> full;  // records refused because the ring was full
+};
+
+// Slot of the ring, followed by ```slot_size - sizeof(ShmSlot)``` bytes of
+// encoded record. ```state``` packs the position the slot is used for
+// with its stage: ```position * 4 + ShmSlotStage```.
+struct ShmSlot {
+  std::atomic<uint64_t> state;
+  std::atomic<int32_t> pid;  // publisher owning the slot, 0 while Free
+  uint32_t size;             // encoded bytes
+  uint32_t checksum;         // FNV-1a of the encoded bytes
+  uint32_t reserved;
+};
+
+enum ShmSlotStage : uint64_t {
+  kShmSlotFree = 0,
+  kShmSlotWriting = 1,
+  kShmSlotReady = 2
+};
+
+constexpr char kShmRingMagic[8] = {'N', 'V', 'L', 'O', 'G', 'S', 'H', '1'};
+constexpr uint32_t kShmRingVersion = 1;
+constexpr size_t kShmRingDataOffset = 4096;
+
+struct ShmRingOptions {
+  // Bytes per slot, header included. Longer messages are truncated.
+  size_t slot_size = 512;
+  size_t slots = 65536;
+  // A slot claimed but not published for this long is skipped by the
+  // consumer; a slot whose publisher process is gone is skipped at once
+  std::chrono::milliseconds abandon_timeout = std::chrono::milliseconds(1000);
+};
+
+// ShmRing
+//
+// Bounded multi-producer single-consumer ring of fixed-size slots in POSIX
+// shared memory, so the ```Logger``` of any process on the host can
+// publish records to one ```nvlogd``` daemon.
+//
+// A publisher claims a position with one CAS on ```head```, then moves
+// its slot Free -> Writing -> Ready with CAS on the slot state. The
+// consumer releases slots in order. A publisher dying between claim and
+// Ready would stall the consumer, so a slot stuck past the timeout (or
+// whose publisher pid is gone) is taken back with a CAS the late publisher
+// then loses, and a checksum rejects the bytes of a torn write. Nothing a
+// crashed process leaves behind can wedge or corrupt the ring.
+class ShmRing {
+ public:
+  ~ShmRing();
+
+  // Create the ring ```name``` (```shm_open``` name, e.g. ```/nvlog```), or
+  // attach to an existing one with the same geometry so publishers survive
+  // a daemon restart. Return nullptr on failure.
+  static std::unique_ptr<ShmRing> Create(
+      const std::string& name, ShmRingOptions options = ShmRingOptions());
+
+  // Attach a publisher to the ring ```name```. Return nullptr when it does
+  // not exist or is not a ring.
+  static std::unique_ptr<ShmRing> Open(const std::string& name);
+
+  static void Unlink(const std::string& name);
+
+  // Publisher side, any thread of any process. Never blocks;
+  // return false when the ring is full or the record does not fit.
+  bool Publish(const LogMessage& log_message);
+
+  // Consumer side, one thread of one process. Pass up to ```max``` records
+  // to ```fn```, oldest first, return the number of slots released.
+  size_t Consume(const std::function<void(LogMessagePtr)>& fn,
+                 size_t max = SIZE_MAX);
+
+  // Sleep until a publisher signals or ```timeout``` elapses
+  void Wait(std::chrono::milliseconds timeout);
+
+  // Slots taken back from dead or stuck publishers
+  uint64_t Abandoned() const {
+    return abandoned_;
+  }
+
+  // Published records rejected by the checksum or the decoder
+  uint64_t Corrupted() const {
+    return corrupted_;
+  }
+
+  uint64_t Full() const {
+    return header_->full.load(std::memory_order_relaxed);
+  }
+
+  // Layout access for tools and tests
+  ShmRingHeader* Header() const {
+    return header_;
+  }
+  ShmSlot* SlotAt(uint64_t position) const;
+
+  void SetAbandonTimeout(std::chrono::milliseconds timeout) {
+    abandon_timeout_ = timeout;
+  }
+
+ private:
+  ShmRing(ShmRingHeader* header, size_t mapped_size);
+
+  static std::unique_ptr<ShmRing> Map(const std::string& name, bool create,
+                                      const ShmRingOptions& options);
+
+  // Return true once the stuck slot at ```position``` was taken back
+  bool TryAbandon(ShmSlot* slot, uint64_t position, uint64_t state);
+
+  ShmRingHeader* header_;
+  size_t mapped_size_;
+  std::chrono::milliseconds abandon_timeout_;
+
+  // Consumer state
+  uint64_t stuck_position_;
+  std::chrono::steady_clock::time_point stuck_since_;
+  uint64_t abandoned_;
+  uint64_t corrupted_;
+};
+
+// ShmRingSink
+//
+// Publish records into the shared memory ring of ```nvlogd``` instead of
+// formatting and writing them in this process. Binary, never blocks: a
+// full ring or a missing daemon drops the record (see ```Dropped()```).
+// When the ring does not exist yet it is looked up again once a second.
+class ShmRingSink : public Sink {
+ public:
+  explicit ShmRingSink(const std::string& name);
+
+  void Log(LogMessagePtr log_message) override;
+
+  void Start() override {}
+
+  void Shutdown(bool /*force*/ = false) override {}
+
+  bool IsRun() const override {
+    return ring_.load(std::memory_order_acquire) != nullptr;
+  }
+
+  bool RendersText() const override {
+    return false;
+  }
+
+  std::string Name() const override {
+    return "shm:" + name_;
+  }
+
+  uint64_t Dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  ShmRing* Ring();
+
+  std::string name_;
+  std::unique_ptr<ShmRing> owned_;
+  std::atomic<ShmRing*> ring_;
+  std::mutex open_mu_;
+  std::chrono::steady_clock::time_point next_open_;
+  std::atomic<uint64_t> dropped_;
+};
+
+}  // namespace nvlog
@@ -3,6 +3,7 @@
 // #include <absl/synchronization/mutex.h>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <iostream>
@@ -10,49 +11,314 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
-#include "nvlog/concurrent_queue.h"
 #include "nvlog/declare.h"
+#include "nvlog/emergency_writer.h"
+#include "nvlog/executor.h"
+#include "nvlog/formatter.h"
+#include "nvlog/memory_budget.h"
+#include "nvlog/metrics.h"
+#include "nvlog/priority_lanes.h"
+#include "nvlog/sink_filter.h"
+#include "nvlog/work_queue.h"
+#include "nvlog/worker_options.h"
 
 namespace nvlog {
 class Sink {
  public:
-  virtual ~Sink() = default;
-  virtual void Log(const std::shared_ptr<LogMessage> log_message) = 0;
+  virtual ~Sink() {
+    SetBufferedBytes(0);
+  }
+  virtual void Log(LogMessagePtr log_message) = 0;
   virtual void Start() = 0;
   virtual void Shutdown(bool force = false) = 0;
   virtual bool IsRun() const = 0;
-  void SetFormatter(void (*formatter)(std::ostringstream&, const LogMessage&)) {
-    formatter_ = formatter;
+
+  // Called from a crash signal handler: write every pending message with
+  // async-signal-safe calls only, to ```fallback_fd``` or the sink own
+  // destination. Must never block, allocate or take a lock it can't try.
+  virtual void EmergencyDrain(int /*fallback_fd*/) {}
+
+  // Write every record handed to the sink so far, then what it buffers;
+  // unlike ```Shutdown``` the sink keeps running. Return false when
+  // ```timeout``` expires first. Not from a sink.
+  virtual bool Sync(std::chrono::milliseconds /*timeout*/) {
+    return true;
+  }
+
+  // Can be changed while running, records already rendered by the
+  // channel with the previous formatter are rendered again by the sink
+  void SetFormatter(Formatter formatter) {
+    formatter_.store(formatter, std::memory_order_relaxed);
+  }
+
+  // Return formatter used by this sink, ```DefaultFormatter``` when unset
+  Formatter GetFormatter() const {
+    Formatter formatter = formatter_.load(std::memory_order_relaxed);
+    return formatter ? formatter : DefaultFormatter;
+  }
+
+  // Sink that does not write formatted text (binary, forwarding)
+  // return false, so the channel never pre-render on its behalf.
+  virtual bool RendersText() const {
+    return true;
+  }
+
+  // Sink written on the producer thread by ```Log``` itself (```SyncSink```)
+  // return true, the channel then dispatches to it inline.
+  virtual bool IsSynchronous() const {
+    return false;
+  }
+
+  // Only log messages at ```min_level``` and above
+  void SetLevel(LogLevel min_level) {
+    filter_.SetLevel(min_level);
+  }
+
+  // Only log levels whose ```LevelBit``` is set in ```mask```
+  void SetLevelMask(uint32_t mask) {
+    filter_.SetLevelMask(mask);
+  }
+
+  // Only log messages with one of ```tags```
+  void AllowTags(const std::vector<std::string>& tags) {
+    filter_.SetTagFilter(TagFilter(TagFilterMode::Allow, tags));
+  }
+
+  // Log every message except the ones with one of ```tags```
+  void DenyTags(const std::vector<std::string>& tags) {
+    filter_.SetTagFilter(TagFilter(TagFilterMode::Deny, tags));
+  }
+
+  const SinkFilter& Filter() const {
+    return filter_;
+  }
+
+  // Name used as metrics label
+  virtual std::string Name() const {
+    return "sink";
+  }
+
+  // Messages waiting to be written
+  virtual size_t QueueDepth() const {
+    return 0;
+  }
+
+  // Count the bytes this sink buffers against the logger ```budget```.
+  // Set by the channel while the sink is not running.
+  void SetMemoryBudget(std::shared_ptr<MemoryBudget> budget) {
+    size_t buffered = buffered_bytes_.load(std::memory_order_relaxed);
+    if (budget_) {
+      budget_->Release(buffered);
+    }
+    budget_ = std::move(budget);
+    if (budget_) {
+      budget_->Charge(buffered);
+    }
+  }
+
+  SinkStats Stats() const {
+    SinkStats stats;
+    stats.name = Name();
+    stats.processed = metrics_.processed.load(std::memory_order_relaxed);
+    stats.bytes_written =
+        metrics_.bytes_written.load(std::memory_order_relaxed);
+    stats.queue_depth = QueueDepth();
+    stats.write_latency = metrics_.write_latency.Snapshot();
+    return stats;
+  }
+
+ protected:
+  // Return the text of ```log_message``` rendered with this sink formatter.
+  // Reuse the text rendered by the channel when the formatter is shared,
+  // otherwise render into ```scratch```.
+  const std::string& Render(const LogMessage& log_message,
+                            std::string& scratch) const {
+    Formatter formatter = GetFormatter();
+    const std::string* cached = log_message.FindRendered(formatter);
+    if (cached) {
+      return *cached;
+    }
+    std::ostringstream ss;
+    formatter(ss, log_message);
+    scratch = ss.str();
+    return scratch;
+  }
+
+  // Account a written message, called by the sink once the bytes are out
+  void RecordWrite(const LogMessage& log_message, size_t bytes) {
+    RecordWrite(log_message.enqueue_ns, bytes);
+  }
+
+  // Same, for a sink that outlives the message before writing it
+  void RecordWrite(uint64_t enqueue_ns, size_t bytes) {
+    metrics_.processed.fetch_add(1, std::memory_order_relaxed);
+    metrics_.bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+    if (enqueue_ns != 0) {
+      metrics_.write_latency.Record(SteadyNowNs() - enqueue_ns);
+    }
+  }
+
+  // Report the bytes now held in the sink own buffers (write buffer,
+  // spill), the memory budget is charged or released the difference
+  void SetBufferedBytes(size_t bytes) {
+    size_t previous =
+        buffered_bytes_.exchange(bytes, std::memory_order_relaxed);
+    if (!budget_ || bytes == previous) {
+      return;
+    }
+    if (bytes > previous) {
+      budget_->Charge(bytes - previous);
+    } else {
+      budget_->Release(previous - bytes);
+    }
+  }
+
+  std::atomic<Formatter> formatter_{nullptr};
+  SinkFilter filter_;
+  SinkMetrics metrics_;
+
+ private:
+  std::shared_ptr<MemoryBudget> budget_;
+  std::atomic<size_t> buffered_bytes_{0};
+};
+
+// SyncSink
+//
+// Sink written on the producer thread: ```Log``` takes the sink lock and
+// calls ```Process``` inline, no queue and no worker thread. The record is
+// out when ```Log``` returns, at the price of the caller paying for the
+// formatting and the I/O. A logger whose sinks are all synchronous starts
+// no thread at all.
+class SyncSink : public Sink {
+ public:
+  SyncSink() : running_(false) {}
+
+  void Log(LogMessagePtr log_message) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Process(log_message);
+  }
+
+  void Start() override {
+    running_.store(true);
+  }
+
+  void Shutdown(bool /*force*/ = false) override {
+    if (!running_.exchange(false))
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    Flush();
+  }
+
+  bool IsRun() const override {
+    return running_.load();
+  }
+
+  bool IsSynchronous() const override {
+    return true;
+  }
+
+  // Records are already written, only the buffers are left
+  bool Sync(std::chrono::milliseconds /*timeout*/) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SyncBuffers();
+    return true;
   }
 
  protected:
-  void (*formatter_)(std::ostringstream&, const LogMessage&) = nullptr;
+  // Called with the sink lock held, on the producer thread
+  virtual void Process(const LogMessagePtr& message) = 0;
+
+  // Called with the sink lock held at shutdown
+  virtual void Flush() {}
+
+  // Called with the sink lock held by ```Sync()```: write what the sink
+  // buffers, the sink keeps running
+  virtual void SyncBuffers() {}
+
+ private:
+  std::mutex mutex_;
+  std::atomic<bool> running_;
 };
 
 class AsyncSink : public Sink {
  public:
-  AsyncSink() : running_(false), prepare_shutdown_(false) {}
+  AsyncSink()
+                  : running_(false),
+                    prepare_shutdown_(false),
+                    scheduled_(false) {
+    worker_options_.name = "nvlog-sink";
+  }
 
   ~AsyncSink() {}
 
-  void Log(const std::shared_ptr<LogMessage> log_message) override {
-    queue_.Enqueue(log_message);
+  void Log(LogMessagePtr log_message) override {
+    queue_.Enqueue(std::move(log_message));
+    if (executor_) {
+      Schedule();
+    }
   }
 
   virtual void Start() override {
     if (running_.load())
       return;
     running_ = true;
-    total_ = 0;
     prepare_shutdown_.store(false);
+    if (executor_) {
+      return;
+    }
     worker_thread_ = std::thread(&AsyncSink::Run, this);
   }
 
+  // Run on a shared ```Executor``` instead of a dedicated thread.
+  // Messages are processed in batches by one executor task at a time
+  // (a strand), so the sink still sees them in order and single threaded.
+  // Must be called before the engine start.
+  void SetExecutor(std::shared_ptr<Executor> executor) {
+    executor_ = executor;
+  }
+
+  // Wait strategy, CPU affinity and name of the worker thread.
+  // Must be called before the engine start.
+  void SetWorkerOptions(WorkerOptions options) {
+    worker_options_ = options;
+    queue_.SetWaitStrategy(options.wait_strategy);
+  }
+
+  // Write records per severity class, an error queued behind a flood of
+  // debug records is written first, see ```PriorityLanes```.
+  // Must be called before the engine start.
+  void SetPriorityLanes(LaneOptions options) {
+    queue_.GetStore().Configure(options);
+  }
+
   virtual void Shutdown(bool force = false) override {
     if(!running_.load() || prepare_shutdown_.load())
       return;
 
+    if (executor_) {
+      prepare_shutdown_.store(true);
+      {
+        std::unique_lock<std::mutex> lock(idle_mu_);
+        idle_cond_.wait(lock, [this] {
+          return !scheduled_.load() &&
+                 (queue_.Empty() || executor_->IsStopped());
+        });
+      }
+      // Left over when the executor was shut down before the sink
+      LogMessagePtr log_message;
+      while (queue_.TryDequeue(log_message)) {
+        if (log_message) {
+          Process(log_message);
+        }
+      }
+      Flush();
+      ReleaseSyncs();
+      running_.store(false);
+      return;
+    }
+
     if (running_.load()) {
       prepare_shutdown_.store(true);
       // Enqueue a null to unblock the worker thread
@@ -68,15 +334,98 @@ class AsyncSink : public Sink {
     return running_.load();
   }
 
+  size_t QueueDepth() const override {
+    return queue_.Size();
+  }
+
+  // A null record queued behind the others marks the point to reach, in
+  // every priority lane (see ```PriorityLanes```).
+  bool Sync(std::chrono::milliseconds timeout) override {
+    if (!running_.load()) {
+      return false;
+    }
+    uint64_t target;
+    {
+      std::lock_guard<std::mutex> lock(idle_mu_);
+      target = ++sync_requested_;
+      queue_.Enqueue(nullptr);
+    }
+    if (executor_) {
+      Schedule();
+    }
+    std::unique_lock<std::mutex> lock(idle_mu_);
+    return idle_cond_.wait_for(lock, timeout,
+                               [this, target] { return synced_ >= target; });
+  }
+
+  void EmergencyDrain(int fallback_fd) override {
+    EmergencyWriter writer(fallback_fd);
+    queue_.TryForEach([&writer](const LogMessagePtr& message) {
+      if (message) {
+        writer.Write(*message);
+      }
+    });
+  }
+
  protected:
-  virtual void Process(const std::shared_ptr<LogMessage>& message) = 0;
+  virtual void Process(const LogMessagePtr& message) = 0;
+
+  // Called on the worker thread once the queue is drained at shutdown
+  virtual void Flush() {}
+
+  // Called on the worker thread whenever it has emptied the queue,
+  // a batching sink sends what it holds
+  virtual void OnDrained() {}
+
+  // Called on the worker thread by ```Sync()``` once the records before
+  // it are processed: write what the sink buffers, the sink keeps running
+  virtual void SyncBuffers() {
+    OnDrained();
+  }
 
  private:
+  static constexpr size_t kDrainBatch = 256;
+
+  void Schedule() {
+    if (!scheduled_.exchange(true, std::memory_order_seq_cst) &&
+        !executor_->Submit([this]() { Drain(); })) {
+      // Executor already shut down, ```Shutdown()``` writes what is queued
+      scheduled_.store(false, std::memory_order_seq_cst);
+      std::lock_guard<std::mutex> lock(idle_mu_);
+      idle_cond_.notify_all();
+    }
+  }
+
+  // Strand task: at most one runs at a time for this sink
+  void Drain() {
+    LogMessagePtr log_message;
+    for (size_t i = 0; i < kDrainBatch && queue_.TryDequeue(log_message);
+         ++i) {
+      if (log_message) {
+        Process(log_message);
+      } else {
+        Synced();
+      }
+    }
+
+    if (queue_.Empty()) {
+      OnDrained();
+    }
+    scheduled_.store(false, std::memory_order_seq_cst);
+    if (!queue_.Empty()) {
+      Schedule();
+      return;
+    }
+    std::lock_guard<std::mutex> lock(idle_mu_);
+    idle_cond_.notify_all();
+  }
+
   void Run() {
+    ConfigureCurrentThread(worker_options_);
     while (running_.load()) {
-      std::shared_ptr<LogMessage> log_message;
+      LogMessagePtr log_message;
       queue_.WaitAndDequeue(log_message);
-      if (prepare_shutdown_.load()) {
+      if (!log_message && prepare_shutdown_.load()) {
 #if NVLOG_DEBUG == 1 && NVLOG_TRACE == 1
         std::cout << "Sink::WORKER_BREAK: " << queue_.Size() << " logs left."
                   << std::endl;
@@ -86,7 +435,11 @@ class AsyncSink : public Sink {
 
       if (log_message) {
         Process(log_message);
-        // total_++;
+        if (queue_.Empty()) {
+          OnDrained();
+        }
+      } else {
+        Synced();
       }
     }
 
@@ -97,7 +450,7 @@ class AsyncSink : public Sink {
                 << std::endl;
 #endif
       while (!queue_.Empty()) {
-        std::shared_ptr<LogMessage> log_message;
+        LogMessagePtr log_message;
 
         queue_.TryDequeue(log_message);
         if (log_message) {
@@ -110,13 +463,40 @@ class AsyncSink : public Sink {
 #endif
     }
 
+    Flush();
+    ReleaseSyncs();
     running_.store(false);
   }
 
-  ConcurrentQueue<std::shared_ptr<LogMessage>> queue_;
+  // Marker of ```Sync()``` reached
+  void Synced() {
+    SyncBuffers();
+    std::lock_guard<std::mutex> lock(idle_mu_);
+    ++synced_;
+    idle_cond_.notify_all();
+  }
+
+  // Shutdown wrote everything, every waiting ```Sync()``` is done
+  void ReleaseSyncs() {
+    std::lock_guard<std::mutex> lock(idle_mu_);
+    synced_ = sync_requested_;
+    idle_cond_.notify_all();
+  }
+
+  WorkQueue<LogMessagePtr, PriorityLanes> queue_;
+  WorkerOptions worker_options_;
   std::thread worker_thread_;
   std::atomic<bool> running_;
   std::atomic<bool> prepare_shutdown_;
-  std::atomic<int64_t> total_;
+
+  // Executor mode
+  std::shared_ptr<Executor> executor_;
+  std::atomic<bool> scheduled_;
+  std::mutex idle_mu_;
+  std::condition_variable idle_cond_;
+
+  // ```Sync()``` markers queued and reached, guarded by ```idle_mu_```
+  uint64_t sync_requested_ = 0;
+  uint64_t synced_ = 0;
 };
 }  // namespace nvlog
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nvlog/declare.h"
+#include "nvlog/rcu.h"
+#include "nvlog/tag_registry.h"
+
+namespace nvlog {
+
+enum class TagFilterMode { None, Allow, Deny };
+
+// TagFilter
+//
+// Tag allow/deny set compiled into a bitmask indexed by interned tag ID.
+// Matching is a single word load, no string compare.
+class TagFilter {
+ public:
+  TagFilter() : mode_(TagFilterMode::None) {}
+
+  TagFilter(TagFilterMode mode, const std::vector<std::string>& tags)
+                  : mode_(mode) {
+    for (const auto& tag : tags) {
+      Set(TagRegistry::Instance().Intern(tag));
+    }
+  }
+
+  TagFilterMode Mode() const {
+    return mode_;
+  }
+
+  // ```kUnresolvedTagId``` is in no set: rejected by Allow, accepted by
+  // Deny
+  bool Matches(uint32_t tag_id) const {
+    if (mode_ == TagFilterMode::None) {
+      return true;
+    }
+    return Test(tag_id) == (mode_ == TagFilterMode::Allow);
+  }
+
+ private:
+  void Set(uint32_t tag_id) {
+    size_t word = tag_id / 64;
+    if (word >= bits_.size()) {
+      bits_.resize(word + 1, 0);
+    }
+    bits_[word] |= uint64_t(1) << (tag_id % 64);
+  }
+
+  bool Test(uint32_t tag_id) const {
+    size_t word = tag_id / 64;
+    if (word >= bits_.size()) {
+      return false;
+    }
+    return (bits_[word] >> (tag_id % 64)) & 1u;
+  }
+
+  TagFilterMode mode_;
+  std::vector<uint64_t> bits_;
+};
+
+// SinkFilter
+//
+// Level threshold and tag filter of one sink, checked by the channel
+// before a message is handed to the sink.
+// Level mask is atomic and the tag filter an RCU snapshot, both can be
+// changed while running without the channel taking a lock.
+class SinkFilter {
+ public:
+  SinkFilter()
+                  : level_mask_(LevelMaskFrom(LogLevel::Trace)),
+                    tag_filter_(std::make_unique<TagFilter>()) {}
+
+  void SetLevel(LogLevel min_level) {
+    level_mask_.store(LevelMaskFrom(min_level), std::memory_order_relaxed);
+  }
+
+  void SetLevelMask(uint32_t mask) {
+    level_mask_.store(mask, std::memory_order_relaxed);
+  }
+
+  uint32_t LevelMask() const {
+    return level_mask_.load(std::memory_order_relaxed);
+  }
+
+  void SetTagFilter(TagFilter tag_filter) {
+    tag_filter_.Store(std::make_unique<TagFilter>(std::move(tag_filter)));
+  }
+
+  bool HasTagFilter() const {
+    return tag_filter_.Load()->Mode() != TagFilterMode::None;
+  }
+
+  bool AcceptsLevel(LogLevel level) const {
+    return (LevelMask() & LevelBit(level)) != 0;
+  }
+
+  bool AcceptsTag(uint32_t tag_id) const {
+    return tag_filter_.Load()->Matches(tag_id);
+  }
+
+ private:
+  std::atomic<uint32_t> level_mask_;
+  RcuPtr<TagFilter> tag_filter_;
+};
+
+}  // namespace nvlog
@@ -0,0 +1,67 @@
+#include "nvlog/tag_registry.h"
+
+#include <mutex>
+
+namespace nvlog {
+
+TagRegistry::TagRegistry() {
+  names_.emplace_back("");
+  ids_.emplace(names_.back(), kEmptyTagId);
+}
+
+TagRegistry& TagRegistry::Instance() {
+  static TagRegistry instance;
+  return instance;
+}
+
+uint32_t TagRegistry::Intern(std::string_view tag) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mu_);
+    auto it = ids_.find(tag);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mu_);
+  auto it = ids_.find(tag);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  auto id = static_cast<uint32_t>(names_.size());
+  names_.emplace_back(tag);
+  ids_.emplace(names_.back(), id);
+  return id;
+}
+
+uint32_t TagRegistry::Find(std::string_view tag) const {
+  std::shared_lock<std::shared_mutex> lock(mu_);
+  auto it = ids_.find(tag);
+  if (it == ids_.end()) {
+    return kUnresolvedTagId;
+  }
+  return it->second;
+}
+
+std::string TagRegistry::Name(uint32_t id) const {
+  std::shared_lock<std::shared_mutex> lock(mu_);
+  if (id >= names_.size()) {
+    return std::string();
+  }
+  return names_[id];
+}
+
+std::string_view TagRegistry::NameView(uint32_t id) const {
+  std::shared_lock<std::shared_mutex> lock(mu_);
+  if (id >= names_.size()) {
+    return std::string_view();
+  }
+  return names_[id];
+}
+
+size_t TagRegistry::Size() const {
+  std::shared_lock<std::shared_mutex> lock(mu_);
+  return names_.size();
+}
+
+}  // namespace nvlog
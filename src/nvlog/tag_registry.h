@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "nvlog/declare.h"
+
+namespace nvlog {
+
+// TagRegistry
+//
+// Intern free-form tags into small integer IDs, so the hot path
+// can compare and filter tags without touching the string.
+// ID 0 is always the empty tag, IDs are never recycled
+// and stay valid for the lifetime of the process.
+class TagRegistry {
+ public:
+  static constexpr uint32_t kEmptyTagId = 0;
+
+  static TagRegistry& Instance();
+
+  // Return the ID of ```tag```, registering it on first use.
+  uint32_t Intern(std::string_view tag);
+
+  // Return the ID of ```tag``` or ```kUnresolvedTagId``` when the tag
+  // was never interned.
+  uint32_t Find(std::string_view tag) const;
+
+  // Return the tag name of ```id```, empty string when unknown.
+  std::string Name(uint32_t id) const;
+
+  // Same, viewing the interned text: names are never moved nor freed, a
+  // record can point at it instead of copying its tag.
+  std::string_view NameView(uint32_t id) const;
+
+  size_t Size() const;
+
+ private:
+  TagRegistry();
+
+  TagRegistry(const TagRegistry&) = delete;
+  TagRegistry& operator=(const TagRegistry&) = delete;
+
+  mutable std::shared_mutex mu_;
+  // Keys view ```names_```, whose strings never move: a lookup builds no
+  // string
+  std::unordered_map<std::string_view, uint32_t> ids_;
+  std::deque<std::string> names_;
+};
+
+// Return the ID of the static tag of a call site, interned on the first
+// call through the call site ```cache```. Never pass runtime text here:
+// the cache would keep the ID of its first value.
+inline uint32_t ResolveTag(std::atomic<uint32_t>& cache,
+                           std::string_view tag) {
+  uint32_t id = cache.load(std::memory_order_relaxed);
+  if (id == kUnresolvedTagId) {
+    id = TagRegistry::Instance().Intern(tag);
+    cache.store(id, std::memory_order_relaxed);
+  }
+  return id;
+}
+
+// TagLevels
+//
+// Minimum level per tag ID, a flat array of atomics read with one relaxed
+// load on the logging path, e.g. DB=Debug and HTTP=Warning while the
+// logger is at Info. Tags without their own level, and IDs past the
+// table, follow the logger level.
+class TagLevels {
+ public:
+  static constexpr uint32_t kCapacity = 4096;
+
+  TagLevels() : count_(0) {
+    for (auto& level : levels_) {
+      level.store(kInherit, std::memory_order_relaxed);
+    }
+  }
+
+  // Return false when ```id``` is past the table
+  bool Set(uint32_t id, LogLevel min_level) {
+    if (id >= kCapacity) {
+      return false;
+    }
+    if (levels_[id].exchange(static_cast<uint8_t>(min_level),
+                             std::memory_order_relaxed) == kInherit) {
+      count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  void Clear(uint32_t id) {
+    if (id < kCapacity &&
+        levels_[id].exchange(kInherit, std::memory_order_relaxed) !=
+            kInherit) {
+      count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  // True once a tag has its own level, until every one is cleared
+  bool Any() const {
+    return count_.load(std::memory_order_relaxed) != 0;
+  }
+
+  LogLevel MinLevel(uint32_t id, LogLevel fallback) const {
+    if (id >= kCapacity) {
+      return fallback;
+    }
+    uint8_t level = levels_[id].load(std::memory_order_relaxed);
+    return level == kInherit ? fallback : static_cast<LogLevel>(level);
+  }
+
+ private:
+  static constexpr uint8_t kInherit = 0xFF;
+
+  std::atomic<uint8_t> levels_[kCapacity];
+  std::atomic<uint32_t> count_;
+};
+
+}  // namespace nvlog
@@ -0,0 +1,185 @@
+#include "nvlog/time_index.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "nvlog/formatter.h"
+
+namespace nvlog {
+
+namespace {
+bool IsValidHeader(const TimeIndexHeader& header) {
+  return std::memcmp(header.magic, kTimeIndexMagic, sizeof(kTimeIndexMagic)) ==
+             0 &&
+         header.version == kTimeIndexVersion &&
+         (header.format == static_cast<uint32_t>(TimeIndexFormat::Text) ||
+          header.format == static_cast<uint32_t>(TimeIndexFormat::Binary));
+}
+
+uint64_t FileSize(const std::string& filename) {
+  struct stat st = {};
+  return ::stat(filename.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size)
+                                            : 0;
+}
+}  // namespace
+
+TimeIndexWriter::TimeIndexWriter(const std::string& log_filename,
+                                 TimeIndexFormat format, size_t block_bytes)
+                : filename_(TimeIndexFilename(log_filename)),
+                  format_(format),
+                  block_bytes_(block_bytes),
+                  fd_(-1),
+                  offset_(FileSize(log_filename)),
+                  block_() {
+  Open();
+}
+
+TimeIndexWriter::~TimeIndexWriter() {
+  EndBlock();
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+// Keep appending to an index that still matches the log, start over when
+// the log was truncated or rotated under it
+void TimeIndexWriter::Open() {
+  fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    ReportError("TimeIndexWriter failed to open index: " + filename_);
+    return;
+  }
+
+  TimeIndexHeader header = {};
+  struct stat st = {};
+  bool reuse = ::fstat(fd_, &st) == 0 &&
+               ::pread(fd_, &header, sizeof(header), 0) ==
+                   static_cast<ssize_t>(sizeof(header)) &&
+               IsValidHeader(header) &&
+               header.format == static_cast<uint32_t>(format_) &&
+               (st.st_size - sizeof(header)) % sizeof(TimeIndexEntry) == 0;
+  if (reuse && static_cast<size_t>(st.st_size) > sizeof(header)) {
+    TimeIndexEntry last = {};
+    reuse = ::pread(fd_, &last, sizeof(last), st.st_size - sizeof(last)) ==
+                static_cast<ssize_t>(sizeof(last)) &&
+            last.offset + last.size <= offset_;
+  }
+  if (reuse) {
+    ::lseek(fd_, 0, SEEK_END);
+    return;
+  }
+
+  std::memcpy(header.magic, kTimeIndexMagic, sizeof(kTimeIndexMagic));
+  header.version = kTimeIndexVersion;
+  header.format = static_cast<uint32_t>(format_);
+  header.block_bytes = block_bytes_;
+  if (::ftruncate(fd_, 0) != 0 ||
+      ::pwrite(fd_, &header, sizeof(header), 0) !=
+          static_cast<ssize_t>(sizeof(header))) {
+    ReportError("TimeIndexWriter failed to write index: " + filename_);
+    ::close(fd_);
+    fd_ = -1;
+    return;
+  }
+  ::lseek(fd_, 0, SEEK_END);
+}
+
+void TimeIndexWriter::Add(const LogMessage& log_message, size_t bytes) {
+  if (fd_ < 0) {
+    return;
+  }
+  if (block_.records == 0) {
+    block_ = TimeIndexEntry();
+    block_.offset = offset_;
+    block_.min_ns = std::numeric_limits<int64_t>::max();
+    block_.max_ns = std::numeric_limits<int64_t>::min();
+  }
+
+  int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   log_message.timestamp.time_since_epoch())
+                   .count();
+  block_.min_ns = std::min(block_.min_ns, ns);
+  block_.max_ns = std::max(block_.max_ns, ns);
+  ++block_.counts[static_cast<size_t>(log_message.log_level)];
+  ++block_.records;
+  block_.size += bytes;
+  offset_ += bytes;
+
+  if (block_.size >= block_bytes_) {
+    EndBlock();
+  }
+}
+
+void TimeIndexWriter::EndBlock() {
+  if (fd_ < 0 || block_.records == 0) {
+    return;
+  }
+  if (::write(fd_, &block_, sizeof(block_)) !=
+      static_cast<ssize_t>(sizeof(block_))) {
+    ReportError("TimeIndexWriter failed to write index: " + filename_);
+    ::close(fd_);
+    fd_ = -1;
+  }
+  block_.records = 0;
+}
+
+bool QueryTimeIndex(const std::string& log_filename, int64_t from_ns,
+                    int64_t to_ns, LogLevel min_level,
+                    std::vector<TimeIndexRange>* ranges,
+                    TimeIndexFormat* format) {
+  std::ifstream file(TimeIndexFilename(log_filename), std::ios::binary);
+  TimeIndexHeader header = {};
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      !IsValidHeader(header)) {
+    return false;
+  }
+  *format = static_cast<TimeIndexFormat>(header.format);
+
+  uint64_t log_size = FileSize(log_filename);
+  uint64_t covered = 0;
+  auto add = [ranges](uint64_t offset, uint64_t size, bool indexed) {
+    if (size == 0) {
+      return;
+    }
+    // Merge with the previous range when contiguous
+    if (!ranges->empty() && ranges->back().indexed == indexed &&
+        ranges->back().offset + ranges->back().size == offset) {
+      ranges->back().size += size;
+    } else {
+      ranges->push_back(TimeIndexRange{offset, size, indexed});
+    }
+  };
+
+  // An unindexed range holds records logged after the entry before it and
+  // before the entry after it: kept only when that span meets the window
+  int64_t gap_from = std::numeric_limits<int64_t>::min();
+  TimeIndexEntry entry;
+  while (file.read(reinterpret_cast<char*>(&entry), sizeof(entry)) &&
+         entry.offset < log_size) {
+    if (entry.offset > covered && gap_from <= to_ns &&
+        entry.max_ns >= from_ns) {
+      add(covered, entry.offset - covered, false);
+    }
+    gap_from = entry.min_ns;
+    uint64_t size = std::min(entry.size, log_size - entry.offset);
+    uint32_t matching = 0;
+    for (size_t level = static_cast<size_t>(min_level); level < 6; ++level) {
+      matching += entry.counts[level];
+    }
+    if (matching != 0 && entry.max_ns >= from_ns && entry.min_ns <= to_ns) {
+      add(entry.offset, size, true);
+    }
+    covered = std::max(covered, entry.offset + size);
+  }
+  if (covered < log_size && gap_from <= to_ns) {
+    add(covered, log_size - covered, false);
+  }
+  return true;
+}
+
+}  // namespace nvlog
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nvlog/declare.h"
+
+namespace nvlog {
+
+// Content of the log file an index describes
+enum class TimeIndexFormat : uint32_t { Text = 1, Binary = 2 };
+
+// Header at the start of a ```<log>.idx``` sidecar, followed by
+// ```TimeIndexEntry``` records in file offset order
+struct TimeIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t format;  // TimeIndexFormat
+  uint64_t block_bytes;
+};
+
+// One block of the log file: ```[offset, offset + size)``` starts and
+// ends on record boundaries. Timestamps are system_clock nanoseconds.
+struct TimeIndexEntry {
+  uint64_t offset;
+  uint64_t size;
+  int64_t min_ns;
+  int64_t max_ns;
+  uint32_t counts[6];  // records per LogLevel
+  uint32_t records;
+  uint32_t reserved;
+};
+
+constexpr char kTimeIndexMagic[8] = {'N', 'V', 'L', 'O', 'G', 'I', 'X', '1'};
+constexpr uint32_t kTimeIndexVersion = 1;
+
+inline std::string TimeIndexFilename(const std::string& log_filename) {
+  return log_filename + ".idx";
+}
+
+// TimeIndexWriter
+//
+// Sparse time index of an append-only log file, kept in a sidecar next
+// to it. The sink reports each record it appends, an entry is written
+// every ```block_bytes``` of log with the time range and level counts of
+// the block, so ```nvlog_query``` can seek straight to a time window.
+// Not thread safe, called under the sink write lock.
+class TimeIndexWriter {
+ public:
+  TimeIndexWriter(const std::string& log_filename, TimeIndexFormat format,
+                  size_t block_bytes = 64 * 1024);
+
+  ~TimeIndexWriter();
+
+  // ```bytes``` of ```log_message``` were appended to the log file
+  void Add(const LogMessage& log_message, size_t bytes);
+
+  // Write the entry of the block in progress, if any. The index stays
+  // open, records added afterward (e.g. once the sink is started again)
+  // begin a new block; the file is only closed by the destructor.
+  void EndBlock();
+
+  bool IsOpen() const {
+    return fd_ >= 0;
+  }
+
+ private:
+  void Open();
+
+  std::string filename_;
+  TimeIndexFormat format_;
+  size_t block_bytes_;
+  int fd_;
+  uint64_t offset_;  // end of the log file once buffered bytes land
+  TimeIndexEntry block_;
+};
+
+// Byte range of a log file selected by ```QueryTimeIndex```.
+// ```indexed``` is false for a range the index does not describe (written
+// before the index was enabled, or after its last entry); it is only
+// selected when the entries around it leave room for the time window, and
+// its records must still be filtered by time.
+struct TimeIndexRange {
+  uint64_t offset;
+  uint64_t size;
+  bool indexed;
+};
+
+// Select the ranges of ```log_filename``` that may hold records between
+// ```from_ns``` and ```to_ns``` at ```min_level``` or above, in file order.
+// Return false when the log has no valid index.
+bool QueryTimeIndex(const std::string& log_filename, int64_t from_ns,
+                    int64_t to_ns, LogLevel min_level,
+                    std::vector<TimeIndexRange>* ranges,
+                    TimeIndexFormat* format);
+
+}  // namespace nvlog
@@ -0,0 +1,236 @@
+#include "nvlog/unix_socket_sink.h"
+
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "nvlog/formatter.h"
+
+namespace nvlog {
+
+namespace {
+constexpr size_t kMaxBatch = IOV_MAX;
+}  // namespace
+
+UnixSocketSink::UnixSocketSink(const std::string& path,
+                               UnixSocketSinkOptions options)
+                : path_(path),
+                  options_(options),
+                  fd_(-1),
+                  pending_bytes_(0),
+                  front_offset_(0),
+                  backoff_(options.min_backoff),
+                  dropped_(0),
+                  reported_(false) {
+  options_.batch_records =
+      std::min(std::max<size_t>(options_.batch_records, 1), kMaxBatch);
+}
+
+UnixSocketSink::~UnixSocketSink() {
+  Disconnect();
+}
+
+void UnixSocketSink::Process(const LogMessagePtr& log_message) {
+  std::string scratch;
+  const std::string& text = Render(*log_message, scratch);
+  pending_.push_back(Pending{text + '\n', log_message->enqueue_ns});
+  pending_bytes_ += pending_.back().text.size();
+
+  // Drop the oldest records, except one already half sent on the stream
+  while (pending_bytes_ > options_.spill_bytes) {
+    auto oldest = pending_.begin() + (front_offset_ > 0 ? 1 : 0);
+    if (oldest + 1 >= pending_.end()) {
+      break;
+    }
+    pending_bytes_ -= oldest->text.size();
+    pending_.erase(oldest);
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (pending_.size() >= options_.batch_records) {
+    Send(false);
+  }
+  SetBufferedBytes(pending_bytes_);
+}
+
+void UnixSocketSink::Flush() {
+  Send(true);
+  if (!pending_.empty()) {
+    ReportError("UnixSocketSink dropped " + std::to_string(pending_.size()) +
+                " records at shutdown, collector unreachable: " + path_);
+    dropped_.fetch_add(pending_.size(), std::memory_order_relaxed);
+    pending_.clear();
+    pending_bytes_ = 0;
+    front_offset_ = 0;
+  }
+  SetBufferedBytes(pending_bytes_);
+  Disconnect();
+}
+
+void UnixSocketSink::Send(bool force) {
+  while (!pending_.empty()) {
+    if (fd_.load(std::memory_order_relaxed) < 0) {
+      if (!force && std::chrono::steady_clock::now() < next_attempt_) {
+        return;
+      }
+      if (!Connect()) {
+        Retry(errno);
+        return;
+      }
+    }
+
+    bool sent = options_.mode == SocketMode::Datagram ? SendDatagrams()
+                                                      : SendStream();
+    if (!sent) {
+      int error = errno;
+      Disconnect();
+      Retry(error);
+      return;
+    }
+  }
+}
+
+bool UnixSocketSink::SendDatagrams() {
+  size_t count = std::min(pending_.size(), options_.batch_records);
+  iovecs_.resize(count);
+  messages_.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    const std::string& text = pending_[i].text;
+    iovecs_[i].iov_base = const_cast<char*>(text.data());
+    iovecs_[i].iov_len = text.size() - 1;  // no newline in a datagram
+    std::memset(&messages_[i], 0, sizeof(messages_[i]));
+    messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+    messages_[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int sent;
+  do {
+    sent = ::sendmmsg(fd_.load(std::memory_order_relaxed), messages_.data(),
+                      static_cast<unsigned int>(count), MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  if (sent < 0 && errno == EMSGSIZE) {
+    // Record larger than the socket accepts, never sendable
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    Pop();
+    return true;
+  }
+  if (sent <= 0) {
+    return false;
+  }
+
+  for (int i = 0; i < sent; ++i) {
+    RecordWrite(pending_.front().enqueue_ns, pending_.front().text.size() - 1);
+    Pop();
+  }
+  return true;
+}
+
+bool UnixSocketSink::SendStream() {
+  size_t count = std::min(pending_.size(), options_.batch_records);
+  iovecs_.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    const std::string& text = pending_[i].text;
+    size_t skip = i == 0 ? front_offset_ : 0;
+    iovecs_[i].iov_base = const_cast<char*>(text.data() + skip);
+    iovecs_[i].iov_len = text.size() - skip;
+  }
+
+  msghdr message = {};
+  message.msg_iov = iovecs_.data();
+  message.msg_iovlen = count;
+  ssize_t written;
+  do {
+    written =
+        ::sendmsg(fd_.load(std::memory_order_relaxed), &message, MSG_NOSIGNAL);
+  } while (written < 0 && errno == EINTR);
+  if (written <= 0) {
+    return false;
+  }
+
+  // Partial write leaves the rest of the first record for the next call
+  size_t left = static_cast<size_t>(written);
+  while (left > 0) {
+    size_t remaining = pending_.front().text.size() - front_offset_;
+    if (left < remaining) {
+      front_offset_ += left;
+      break;
+    }
+    left -= remaining;
+    RecordWrite(pending_.front().enqueue_ns, pending_.front().text.size());
+    Pop();
+  }
+  return true;
+}
+
+bool UnixSocketSink::Connect() {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path_.size() >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  std::memcpy(address.sun_path, path_.data(), path_.size());
+
+  int type = options_.mode == SocketMode::Datagram ? SOCK_DGRAM : SOCK_STREAM;
+  int fd = ::socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    int error = errno;
+    ::close(fd);
+    errno = error;
+    return false;
+  }
+
+  // Bound the time a stalled collector can hold the sink worker
+  timeval timeout;
+  timeout.tv_sec = options_.send_timeout.count() / 1000;
+  timeout.tv_usec = (options_.send_timeout.count() % 1000) * 1000;
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  fd_.store(fd, std::memory_order_relaxed);
+  backoff_ = options_.min_backoff;
+  reported_ = false;
+  return true;
+}
+
+void UnixSocketSink::Disconnect() {
+  int fd = fd_.exchange(-1, std::memory_order_relaxed);
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  // The collector got a torn line for the half sent record on the old
+  // stream, resending it whole would deliver its start twice: drop it and
+  // restart on a record boundary
+  if (front_offset_ > 0) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    Pop();
+  }
+}
+
+// Schedule the next connection attempt, report once per outage
+void UnixSocketSink::Retry(int error) {
+  if (!reported_) {
+    ReportError("UnixSocketSink collector unreachable, spilling: " + path_ +
+                " (" + std::strerror(error) + ")");
+    reported_ = true;
+  }
+  next_attempt_ = std::chrono::steady_clock::now() + backoff_;
+  backoff_ = std::min(backoff_ * 2, options_.max_backoff);
+}
+
+void UnixSocketSink::Pop() {
+  pending_bytes_ -= pending_.front().text.size();
+  pending_.pop_front();
+  front_offset_ = 0;
+}
+
+}  // namespace nvlog
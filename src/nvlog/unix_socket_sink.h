@@ -0,0 +1,112 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "nvlog/sink.h"
+
+namespace nvlog {
+
+enum class SocketMode {
+  // ```SOCK_DGRAM```, one record per datagram, batched with ```sendmmsg```
+  Datagram,
+  // ```SOCK_STREAM```, newline separated records, batched with gathered
+  // writes (```sendmsg``` with an iovec array, like ```writev``` but
+  // without ```SIGPIPE```)
+  Stream
+};
+
+struct UnixSocketSinkOptions {
+  SocketMode mode = SocketMode::Datagram;
+  // Records sent per system call at most
+  size_t batch_records = 64;
+  // Records waiting for the collector are kept up to this many bytes,
+  // the oldest are dropped beyond it
+  size_t spill_bytes = 4 * 1024 * 1024;
+  // Reconnect delay, doubled after each failed attempt
+  std::chrono::milliseconds min_backoff = std::chrono::milliseconds(100);
+  std::chrono::milliseconds max_backoff = std::chrono::milliseconds(5000);
+  // Send blocked this long on a full collector counts as a failure
+  std::chrono::milliseconds send_timeout = std::chrono::milliseconds(1000);
+};
+
+// UnixSocketSink
+//
+// Ship formatted records to a node-local collector listening on a Unix
+// socket. Records are sent in batches once ```batch_records``` are
+// pending or the sink queue is empty. While the collector is unreachable
+// they spill into a bounded buffer and the sink reconnects with
+// exponential backoff; the spill is sent first once it is back. A stream
+// record half sent when the connection fails is dropped, not resent.
+class UnixSocketSink : public AsyncSink {
+ public:
+  explicit UnixSocketSink(
+      const std::string& path,
+      UnixSocketSinkOptions options = UnixSocketSinkOptions());
+
+  ~UnixSocketSink();
+
+  std::string Name() const override {
+    return "unix:" + path_;
+  }
+
+  // Records dropped because the spill buffer was full or a stream
+  // connection failed in the middle of them
+  uint64_t Dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  bool Connected() const {
+    return fd_.load(std::memory_order_relaxed) >= 0;
+  }
+
+ protected:
+  void Process(const LogMessagePtr& log_message) override;
+
+  void OnDrained() override {
+    Send(false);
+    SetBufferedBytes(pending_bytes_);
+  }
+
+  // Last chance at shutdown, the backoff is ignored. Records the
+  // collector still doesn't take are counted as dropped.
+  void Flush() override;
+
+ private:
+  struct Pending {
+    std::string text;  // ends with '\n'
+    uint64_t enqueue_ns;
+  };
+
+  // Send pending records while the collector accepts them
+  void Send(bool force);
+  // One batch, return false when the connection failed
+  bool SendDatagrams();
+  bool SendStream();
+  bool Connect();
+  void Disconnect();
+  void Retry(int error);
+  void Pop();
+
+  std::string path_;
+  UnixSocketSinkOptions options_;
+  std::atomic<int> fd_;
+  std::deque<Pending> pending_;
+  size_t pending_bytes_;
+  size_t front_offset_;  // bytes of the first record already on a stream
+  std::chrono::milliseconds backoff_;
+  std::chrono::steady_clock::time_point next_attempt_;
+  std::atomic<uint64_t> dropped_;
+  bool reported_;  // outage already reported
+  std::vector<iovec> iovecs_;
+  std::vector<mmsghdr> messages_;
+};
+
+}  // namespace nvlog
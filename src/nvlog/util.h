@@ -5,12 +5,14 @@
 #include <iostream>
 #include <sstream>
 
+#include "nvlog/declare.h"
+
 namespace nvlog {
 
 inline std::string FormatTimestamp(
     const std::chrono::system_clock::time_point& tp) {
   std::time_t time = std::chrono::system_clock::to_time_t(tp);
-  std::tm tm = *std::localtime(&time);
+  std::tm tm = LocalTime(time);
   std::chrono::microseconds us =
       std::chrono::duration_cast<std::chrono::microseconds>(
           tp.time_since_epoch()) %
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "nvlog/mpsc_queue.h"
+#include "nvlog/worker_options.h"
+
+namespace nvlog {
+
+// WorkQueue
+//
+// Lock-free MPSC queue feeding one worker thread, with a pluggable
+// ```WaitStrategy``` for the worker side. ```Store``` holds the items,
+// one ```MpscQueue``` or several (```PriorityLanes```).
+// Only the ```Blocking``` strategy ever makes a producer touch a mutex, and
+// only when the worker is asleep, so with a spinning strategy producers
+// never make a futex syscall.
+template <typename T, typename Store = MpscQueue<T>>
+class WorkQueue {
+ public:
+  explicit WorkQueue(WaitStrategy wait_strategy = WaitStrategy::Blocking)
+                  : wait_strategy_(wait_strategy), sleeping_(false) {}
+
+  // Must be called while no worker waits on the queue
+  void SetWaitStrategy(WaitStrategy wait_strategy) {
+    wait_strategy_ = wait_strategy;
+  }
+
+  WaitStrategy GetWaitStrategy() const {
+    return wait_strategy_;
+  }
+
+  // Must only be configured while no worker nor producer uses the queue
+  Store& GetStore() {
+    return queue_;
+  }
+
+  void Enqueue(T value) {
+    queue_.Enqueue(std::move(value));
+    if (wait_strategy_ == WaitStrategy::Blocking &&
+        sleeping_.load(std::memory_order_seq_cst)) {
+      std::lock_guard<std::mutex> lock(mu_);
+      cond_.notify_one();
+    }
+  }
+
+  bool TryDequeue(T& value) {
+    return queue_.TryDequeue(value);
+  }
+
+  // Worker only, wait until an item is dequeued
+  void WaitAndDequeue(T& value) {
+    uint32_t idle = 0;
+    while (!queue_.TryDequeue(value)) {
+      Wait(idle++);
+    }
+  }
+
+  size_t Size() const {
+    return queue_.Size();
+  }
+
+  bool Empty() const {
+    return queue_.Empty();
+  }
+
+  template <typename Fn>
+  bool TryForEach(Fn fn) const {
+    return queue_.TryForEach(fn);
+  }
+
+ private:
+  static constexpr uint32_t kSpinRounds = 1000;
+
+  void Wait(uint32_t idle) {
+    // Size is ahead of the link for a moment, the item is about to land
+    if (!queue_.Empty()) {
+      CpuRelax();
+      return;
+    }
+
+    switch (wait_strategy_) {
+      case WaitStrategy::BusySpin:
+        CpuRelax();
+        break;
+      case WaitStrategy::SpinYield:
+        if (idle < kSpinRounds) {
+          CpuRelax();
+        } else {
+          std::this_thread::yield();
+        }
+        break;
+      case WaitStrategy::SpinPark:
+        if (idle < kSpinRounds) {
+          CpuRelax();
+        } else {
+          uint32_t shift = std::min<uint32_t>(idle - kSpinRounds, 10);
+          std::this_thread::sleep_for(std::chrono::microseconds(1u << shift));
+        }
+        break;
+      case WaitStrategy::Blocking:
+      default: {
+        std::unique_lock<std::mutex> lock(mu_);
+        sleeping_.store(true, std::memory_order_seq_cst);
+        cond_.wait(lock, [this] { return !queue_.Empty(); });
+        sleeping_.store(false, std::memory_order_relaxed);
+        break;
+      }
+    }
+  }
+
+  Store queue_;
+  WaitStrategy wait_strategy_;
+  std::atomic<bool> sleeping_;
+  std::mutex mu_;
+  std::condition_variable cond_;
+};
+
+}  // namespace nvlog
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <string>
+#include <thread>
+
+#include "nvlog/clock.h"
+
+namespace nvlog {
+
+// How a worker waits for work, and what producers pay to wake it
+enum class WaitStrategy {
+  // Sleep on a condition variable. Producers only lock and notify when
+  // the worker is actually asleep.
+  Blocking,
+  // Spin a while, then yield the CPU. Producers never notify.
+  SpinYield,
+  // Spin a while, then sleep with exponential backoff (1us up to 1ms).
+  // Producers never notify.
+  SpinPark,
+  // Spin forever on a dedicated core. Producers never notify.
+  BusySpin
+};
+
+// WorkerOptions
+//
+// Configuration of a logging worker thread (channel or sink).
+// ```cpu``` pins the thread when not negative, ```name``` is shown by
+// ```top -H```, ```ps -L``` and debuggers (truncated to 15 chars).
+struct WorkerOptions {
+  WaitStrategy wait_strategy = WaitStrategy::Blocking;
+  int cpu = -1;
+  std::string name;
+};
+
+// Hint the CPU we are in a spin loop
+inline void CpuRelax() {
+#if NVLOG_HAS_TSC
+  _mm_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// Apply name and CPU affinity of ```options``` to the calling thread.
+// Best effort, silently ignored where not supported.
+inline void ConfigureCurrentThread(const WorkerOptions& options) {
+#if defined(__linux__)
+  if (!options.name.empty()) {
+    pthread_setname_np(pthread_self(), options.name.substr(0, 15).c_str());
+  }
+  if (options.cpu >= 0 && options.cpu < CPU_SETSIZE) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(options.cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+}
+
+}  // namespace nvlog
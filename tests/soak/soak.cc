@@ -0,0 +1,488 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvlog/nvlog.h"
+
+// Soak and shutdown-under-load harness.
+//
+// Mixed producers (site records at every level, runtime tags, lazy
+// messages, bursts of large records) log into one logger for
+// ```--seconds``` while its engine is shut down and restarted every
+// ```--cycle-ms```. Each cycle also runs a short-lived logger whose engine
+// is shut down while two threads are still bursting into it.
+//
+// Every record carries its producer and sequence number, each sink checks
+// it sees the records of a producer in order, once each. Records logged
+// while an engine is shut down are refused and counted as dropped:
+// - main logger: every record logged reaches every sink exactly once, or
+//   is counted as dropped
+// - short-lived logger: every record logged before the shutdown started is
+//   delivered, every later one is delivered or counted as dropped
+//
+// Fails (exit 1) on a delivery error, or when the CPU time per record, the
+// CPU time while idle, the RSS growth or the worst shutdown latency exceed
+// their threshold.
+//
+// Usage: nvlog_soak [--seconds S] [--producers N] [--cycle-ms MS]
+//                   [--max-cpu-us-per-record US] [--max-idle-cpu R]
+//                   [--max-rss-growth-mb MB] [--max-shutdown-ms MS]
+namespace {
+
+struct SoakOptions {
+  double seconds = 10;
+  int producers = 4;
+  int cycle_ms = 200;
+  double max_cpu_us_per_record = 50;
+  double max_idle_cpu = 0.05;  // CPU seconds per second, engine idle
+  double max_rss_growth_mb = 64;
+  double max_shutdown_ms = 1000;
+};
+
+constexpr size_t kMaxBacklog = 20000;
+constexpr int kBurstThreads = 2;
+constexpr int kBurstRecords = 5000;
+
+bool ParseOptions(int argc, char* argv[], SoakOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+    double value = std::atof(argv[++i]);
+    if (arg == "--seconds") {
+      options->seconds = value;
+    } else if (arg == "--producers") {
+      options->producers = std::max(1, static_cast<int>(value));
+    } else if (arg == "--cycle-ms") {
+      options->cycle_ms = std::max(1, static_cast<int>(value));
+    } else if (arg == "--max-cpu-us-per-record") {
+      options->max_cpu_us_per_record = value;
+    } else if (arg == "--max-idle-cpu") {
+      options->max_idle_cpu = value;
+    } else if (arg == "--max-rss-growth-mb") {
+      options->max_rss_growth_mb = value;
+    } else if (arg == "--max-shutdown-ms") {
+      options->max_shutdown_ms = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+double CpuSeconds() {
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+double RssMb() {
+  long pages = 0;
+  FILE* statm = std::fopen("/proc/self/statm", "r");
+  if (statm) {
+    long size = 0;
+    if (std::fscanf(statm, "%ld %ld", &size, &pages) != 2) {
+      pages = 0;
+    }
+    std::fclose(statm);
+  }
+  return static_cast<double>(pages) * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+// Delivery check of one sink: records are ```<producer>:<sequence> ...```,
+// the records of a producer must come in sequence, refused records leave
+// gaps. A slot is only touched by the thread currently writing the sink
+// for that producer.
+class Tally {
+ public:
+  explicit Tally(int producers) : next_(producers, 0), seen_(producers, 0) {}
+
+  void See(const nvlog::LogMessage& log_message) {
+    char* end = nullptr;
+    unsigned long producer =
+        std::strtoul(log_message.message.c_str(), &end, 10);
+    if (*end != ':' || producer >= next_.size()) {
+      errors_.fetch_add(1);
+      return;
+    }
+    uint64_t sequence = std::strtoull(end + 1, nullptr, 10);
+    uint64_t& next = next_[producer];
+    if (sequence < next) {
+      // Delivered twice or out of order
+      errors_.fetch_add(1);
+    }
+    next = std::max(next, sequence + 1);
+    ++seen_[producer];
+  }
+
+  // Records of ```producer``` delivered so far
+  uint64_t Delivered(int producer) const {
+    return seen_[producer];
+  }
+
+  // Records of ```producer``` up to the last one delivered, in sequence
+  uint64_t Reached(int producer) const {
+    return next_[producer];
+  }
+
+  uint64_t Errors() const {
+    return errors_.load();
+  }
+
+ private:
+  std::vector<uint64_t> next_;
+  std::vector<uint64_t> seen_;
+  std::atomic<uint64_t> errors_{0};
+};
+
+class TallyAsyncSink : public nvlog::AsyncSink {
+ public:
+  explicit TallyAsyncSink(int producers) : tally(producers) {}
+
+  Tally tally;
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    std::string scratch;
+    Render(*log_message, scratch);
+    tally.See(*log_message);
+  }
+};
+
+class TallySyncSink : public nvlog::SyncSink {
+ public:
+  explicit TallySyncSink(int producers) : tally(producers) {}
+
+  Tally tally;
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    tally.See(*log_message);
+  }
+};
+
+// Sinks of one logger: a dedicated worker, a shared executor and the
+// producer thread
+struct SinkSet {
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks;
+  std::vector<const Tally*> tallies;
+
+  SinkSet(int producers, const std::shared_ptr<nvlog::Executor>& executor) {
+    auto dedicated = std::make_shared<TallyAsyncSink>(producers);
+    auto pooled = std::make_shared<TallyAsyncSink>(producers);
+    pooled->SetExecutor(executor);
+    auto inline_sink = std::make_shared<TallySyncSink>(producers);
+    sinks = {dedicated, pooled, inline_sink};
+    tallies = {&dedicated->tally, &pooled->tally, &inline_sink->tally};
+  }
+};
+
+std::string Record(int producer, uint64_t sequence, size_t padding = 0) {
+  std::string message =
+      std::to_string(producer) + ":" + std::to_string(sequence) + " soak";
+  message.append(padding, 'x');
+  return message;
+}
+
+// One record of producer ```id```, the logging call depends on its kind
+void LogOne(const nvlog::Logger& logger, int id, uint64_t sequence) {
+  switch (id % 4) {
+    case 0: {
+      // Site records, one site per level
+      switch (sequence % 3) {
+        case 0: {
+          NVLOG_SITE(nvlog::LogLevel::Trace, "SOAK");
+          logger.Log(nvlog_site, Record(id, sequence));
+          break;
+        }
+        case 1: {
+          NVLOG_SITE(nvlog::LogLevel::Info, "SOAK");
+          logger.Log(nvlog_site, Record(id, sequence));
+          break;
+        }
+        default: {
+          NVLOG_SITE(nvlog::LogLevel::Error, "SOAK");
+          logger.Log(nvlog_site, Record(id, sequence));
+          break;
+        }
+      }
+      break;
+    }
+    case 1: {
+      std::string tag = "SOAK" + std::to_string(sequence % 8);
+      logger.Log(nvlog::LogLevel::Debug, Record(id, sequence), tag, __FILE__,
+                 __LINE__);
+      break;
+    }
+    case 2: {
+      NVLOG_SITE(nvlog::LogLevel::Warning, "");
+      logger.LogLazy(nvlog_site,
+                     [id, sequence]() { return Record(id, sequence); });
+      break;
+    }
+    default: {
+      NVLOG_SITE(nvlog::LogLevel::Info, "");
+      logger.Log(nvlog_site, Record(id, sequence, 512 + sequence % 3584),
+                 "BURST");
+      break;
+    }
+  }
+}
+
+uint64_t Backlog(const nvlog::Logger& logger) {
+  nvlog::LoggerStats stats = logger.GetStats();
+  uint64_t deepest = 0;
+  for (const auto& sink : stats.sinks) {
+    deepest = std::max(deepest, sink.queue_depth);
+  }
+  return stats.queue_depth + deepest;
+}
+
+// Engine shut down, or refusing records while it shuts down
+bool Refusing(const nvlog::Logger& logger, uint64_t& dropped) {
+  uint64_t now = logger.GetStats().dropped;
+  bool refusing = now != dropped || !logger.IsRun();
+  dropped = now;
+  return refusing;
+}
+
+// Log until ```stop```, waiting whenever the backlog is over
+// ```kMaxBacklog``` or the engine refuses records; the records logged
+// before noticing it are dropped. Bursting producers pause between bursts.
+void Produce(const nvlog::Logger& logger, int id,
+             const std::atomic<bool>& stop, std::atomic<uint64_t>& produced) {
+  uint64_t sequence = 0;
+  uint64_t dropped = 0;
+  while (!stop.load()) {
+    if (sequence % 256 == 0) {
+      while (!stop.load() && (Backlog(logger) > kMaxBacklog ||
+                              Refusing(logger, dropped))) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    LogOne(logger, id, sequence);
+    produced.store(++sequence);
+    if (id % 4 == 3 && sequence % 1000 == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+}
+
+class Soak {
+ public:
+  explicit Soak(SoakOptions options)
+                  : options_(options),
+                    executor_(std::make_shared<nvlog::Executor>(1)) {}
+
+  ~Soak() {
+    executor_->Shutdown();
+  }
+
+  bool Run() {
+    SinkSet main_sinks(options_.producers, executor_);
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         main_sinks.sinks);
+    logger.StartEngine();
+
+    std::atomic<bool> stop(false);
+    std::vector<std::atomic<uint64_t>> produced(options_.producers);
+    std::vector<std::thread> producers;
+    for (int id = 0; id < options_.producers; ++id) {
+      producers.emplace_back([&logger, id, &stop, &produced]() {
+        Produce(logger, id, stop, produced[id]);
+      });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::duration<double>(options_.seconds));
+    double cpu_start = CpuSeconds();
+    double rss_start = 0;
+    int cycles = 0;
+    while (std::chrono::steady_clock::now() < end) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(options_.cycle_ms));
+      // Mid-burst: producers keep logging while the engine is down
+      TimedShutdown(logger);
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      logger.StartEngine();
+      ShortLived();
+      if (++cycles == 1) {
+        rss_start = RssMb();  // allocator warmed up
+      }
+    }
+
+    stop.store(true);
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    uint64_t records = 0;
+    for (const auto& count : produced) {
+      records += count.load();
+    }
+    while (Backlog(logger) > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double wall = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    double cpu = CpuSeconds() - cpu_start;
+
+    // Nothing to do: the workers must not burn CPU
+    double idle_start = CpuSeconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    double idle_cpu = (CpuSeconds() - idle_start) / 0.5;
+
+    TimedShutdown(logger);
+    uint64_t dropped = logger.GetStats().dropped;
+    for (size_t s = 0; s < main_sinks.tallies.size(); ++s) {
+      const Tally& tally = *main_sinks.tallies[s];
+      Expect(tally.Errors() == 0,
+             "main sink " + std::to_string(s) + ": " +
+                 std::to_string(tally.Errors()) + " records out of sequence");
+      uint64_t delivered = 0;
+      for (int id = 0; id < options_.producers; ++id) {
+        delivered += tally.Delivered(id);
+      }
+      Expect(delivered + dropped == records,
+             "main sink " + std::to_string(s) + ": " +
+                 std::to_string(delivered) + " delivered and " +
+                 std::to_string(dropped) + " dropped of " +
+                 std::to_string(records) + " records");
+    }
+    double rss_growth = RssMb() - rss_start;
+    double cpu_us_per_record = records ? cpu * 1e6 / records : 0;
+
+    std::cout << "cycles=" << cycles << " records=" << records
+              << " dropped=" << dropped
+              << " short_lived_records=" << short_lived_records_
+              << " wall_s=" << wall << " cpu_s=" << cpu
+              << " cpu_us_per_record=" << cpu_us_per_record
+              << " idle_cpu=" << idle_cpu << " rss_growth_mb=" << rss_growth
+              << " max_shutdown_ms=" << max_shutdown_ms_ << std::endl;
+
+    Expect(cycles > 0, "no start/shutdown cycle ran");
+    Expect(cpu_us_per_record <= options_.max_cpu_us_per_record,
+           "CPU per record over " +
+               std::to_string(options_.max_cpu_us_per_record) + " us");
+    Expect(idle_cpu <= options_.max_idle_cpu,
+           "idle CPU over " + std::to_string(options_.max_idle_cpu));
+    Expect(rss_growth <= options_.max_rss_growth_mb,
+           "RSS growth over " + std::to_string(options_.max_rss_growth_mb) +
+               " MB");
+    Expect(max_shutdown_ms_ <= options_.max_shutdown_ms,
+           "shutdown latency over " +
+               std::to_string(options_.max_shutdown_ms) + " ms");
+    return ok_;
+  }
+
+ private:
+  void TimedShutdown(nvlog::Logger& logger) {
+    auto start = std::chrono::steady_clock::now();
+    logger.ShutdownEngine();
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    max_shutdown_ms_ = std::max(max_shutdown_ms_, ms);
+  }
+
+  // A logger shut down while its producers are still bursting. Records
+  // logged before the shutdown started must all be delivered.
+  void ShortLived() {
+    SinkSet sinks(kBurstThreads, executor_);
+    auto logger = std::make_unique<nvlog::Logger>(
+        std::make_shared<nvlog::limiters::NullLimiter>(), sinks.sinks);
+    logger->StartEngine();
+
+    std::atomic<bool> stop(false);
+    std::vector<std::atomic<uint64_t>> produced(kBurstThreads);
+    std::vector<std::thread> bursts;
+    for (int id = 0; id < kBurstThreads; ++id) {
+      bursts.emplace_back([&logger, id, &stop, &produced]() {
+        for (uint64_t i = 0; i < kBurstRecords && !stop.load(); ++i) {
+          LogOne(*logger, id, i);
+          produced[id].store(i + 1);
+        }
+      });
+    }
+    while (produced[0].load() < kBurstRecords / 2) {
+      std::this_thread::yield();
+    }
+
+    std::vector<uint64_t> before;
+    for (const auto& count : produced) {
+      before.push_back(count.load());
+    }
+    TimedShutdown(*logger);
+    stop.store(true);
+    for (auto& burst : bursts) {
+      burst.join();
+    }
+
+    // Nothing logged after the shutdown may wait in the queue unseen
+    uint64_t dropped = logger->GetStats().dropped;
+    uint64_t records = 0;
+    for (const auto& count : produced) {
+      records += count.load();
+    }
+    for (size_t s = 0; s < sinks.tallies.size(); ++s) {
+      const Tally& tally = *sinks.tallies[s];
+      Expect(tally.Errors() == 0,
+             "short-lived sink " + std::to_string(s) + ": " +
+                 std::to_string(tally.Errors()) + " records out of sequence");
+      uint64_t delivered = 0;
+      for (int id = 0; id < kBurstThreads; ++id) {
+        Expect(tally.Delivered(id) >= before[id] &&
+                   tally.Delivered(id) == tally.Reached(id),
+               "short-lived sink " + std::to_string(s) + " producer " +
+                   std::to_string(id) + ": " +
+                   std::to_string(tally.Delivered(id)) + " of " +
+                   std::to_string(before[id]) + " records");
+        delivered += tally.Delivered(id);
+      }
+      Expect(delivered + dropped == records,
+             "short-lived sink " + std::to_string(s) + ": " +
+                 std::to_string(delivered) + " delivered and " +
+                 std::to_string(dropped) + " dropped of " +
+                 std::to_string(records) + " records");
+    }
+    short_lived_records_ += records;
+  }
+
+  void Expect(bool condition, const std::string& failure) {
+    if (!condition) {
+      std::cerr << "FAIL: " << failure << std::endl;
+      ok_ = false;
+    }
+  }
+
+  SoakOptions options_;
+  std::shared_ptr<nvlog::Executor> executor_;
+  double max_shutdown_ms_ = 0;
+  uint64_t short_lived_records_ = 0;
+  bool ok_ = true;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  SoakOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::cerr << "Usage: nvlog_soak [--seconds S] [--producers N] "
+                 "[--cycle-ms MS] [--max-cpu-us-per-record US] "
+                 "[--max-idle-cpu R] [--max-rss-growth-mb MB] "
+                 "[--max-shutdown-ms MS]"
+              << std::endl;
+    return 2;
+  }
+  Soak soak(options);
+  return soak.Run() ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "nvlog/logger.h"
+
+// Explanation
+// # Rate limited before building:
+//
+// A refused record never calls its message callable: the rate limiter is
+// consulted before the record is built, refused records are only counted.
+//
+// # Logger level:
+//
+// Records below the logger level are dropped before the limiter, without
+// taking a token.
+//
+// # Macros:
+//
+// The message expression of ```LOG_*``` and the callable of ```LOG_*_L```
+// are only evaluated for admitted records. A literal tag of ```LOG_*_T```
+// lives in the site and its record carries the resolved tag ID, a
+// ```char``` buffer or a ```const char[]``` on the stack is copied.
+
+namespace {
+
+class KeepSink : public nvlog::SyncSink {
+ public:
+  std::vector<std::string> messages;
+  std::vector<nvlog::LogMessagePtr> records;
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    messages.push_back(log_message->message);
+    records.push_back(log_message);
+  }
+};
+
+// Allow the first ```budget``` calls
+class CountLimiter : public nvlog::limiters::RateLimiter {
+ public:
+  explicit CountLimiter(int budget) : budget_(budget) {}
+
+  bool Allow() override {
+    calls.fetch_add(1);
+    return budget_.fetch_sub(1) > 0;
+  }
+
+  std::atomic<int> calls{0};
+
+ private:
+  std::atomic<int> budget_;
+};
+
+std::string Expensive(int& calls) {
+  ++calls;
+  return "expensive " + std::to_string(calls);
+}
+
+}  // namespace
+
+TEST_CASE("Admission Test") {
+  SECTION("Rate limited before building") {
+    auto sink = std::make_shared<KeepSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    auto limiter = std::make_shared<CountLimiter>(10);
+    nvlog::Logger logger(limiter, sinks);
+    logger.StartEngine();
+
+    NVLOG_SITE(nvlog::LogLevel::Info, "ADMIT");
+    int calls = 0;
+    for (int i = 0; i < 100; ++i) {
+      logger.LogLazy(nvlog_site, [&calls]() { return Expensive(calls); });
+    }
+    logger.ShutdownEngine();
+
+    REQUIRE(calls == 10);
+    REQUIRE(sink->messages.size() == 10);
+    REQUIRE(sink->messages.back() == "expensive 10");
+    auto stats = logger.GetStats();
+    REQUIRE(stats.rate_limited == 90);
+    REQUIRE(stats.enqueued == 10);
+  }
+
+  SECTION("Logger level") {
+    auto sink = std::make_shared<KeepSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    auto limiter = std::make_shared<CountLimiter>(1000);
+    nvlog::Logger logger(limiter, sinks);
+    logger.SetLevel(nvlog::LogLevel::Warning);
+    logger.StartEngine();
+
+    int calls = 0;
+    NVLOG_SITE(nvlog::LogLevel::Debug, "ADMIT");
+    logger.LogLazy(nvlog_site, [&calls]() { return Expensive(calls); });
+    logger.Log(nvlog::LogLevel::Info, "info", "ADMIT", __FILE__, __LINE__);
+    REQUIRE(calls == 0);
+    REQUIRE(limiter->calls.load() == 0);
+
+    logger.Log(nvlog::LogLevel::Error, "error", "ADMIT", __FILE__, __LINE__);
+    logger.SetLevel(nvlog::LogLevel::Trace);
+    logger.LogLazy(nvlog_site, [&calls]() { return Expensive(calls); });
+    logger.ShutdownEngine();
+
+    REQUIRE(calls == 1);
+    REQUIRE(limiter->calls.load() == 2);
+    REQUIRE(sink->messages == std::vector<std::string>{"error", "expensive 1"});
+  }
+
+  SECTION("Macros") {
+    auto sink = std::make_shared<KeepSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger::RegisterLogger(sinks);
+    nvlog::Logger* logger = nvlog::Logger::Current();
+    REQUIRE(logger == nvlog::Logger::Get().get());
+    logger->StartEngine();
+    logger->SetLevel(nvlog::LogLevel::Info);
+
+    int calls = 0;
+    LOG_DEBUG(Expensive(calls));
+    LOG_DEBUG_T(Expensive(calls), "ADMIT");
+    LOG_DEBUG_L([&calls]() { return Expensive(calls); });
+    REQUIRE(calls == 0);
+
+    LOG_INFO(Expensive(calls));
+    LOG_WARN_T(Expensive(calls), "ADMIT");
+    LOG_ERROR_L([&calls]() {
+      std::string a, b;
+      a = Expensive(calls);
+      return a + b;
+    });
+    {
+      char buffer[32] = {};
+      std::snprintf(buffer, sizeof(buffer), "worker-%d", 7);
+      LOG_WARN_T("buffer tag", buffer);
+      std::memset(buffer, 'x', sizeof(buffer) - 1);
+    }
+    {
+      const char tag[] = "LOCAL";
+      LOG_WARN_T("local tag", tag);
+    }
+    logger->ShutdownEngine();
+
+    REQUIRE(calls == 3);
+    REQUIRE(sink->messages ==
+            std::vector<std::string>{"expensive 1", "expensive 2",
+                                     "expensive 3", "buffer tag",
+                                     "local tag"});
+    const auto& literal = *sink->records[1];
+    REQUIRE(literal.tag == "ADMIT");
+    REQUIRE(literal.tag.data() == literal.site->tag.data());
+    REQUIRE_FALSE(literal.storage);
+    REQUIRE(literal.tag_id == nvlog::TagRegistry::Instance().Find("ADMIT"));
+    const auto& copied = *sink->records[3];
+    REQUIRE(copied.tag == "worker-7");
+    REQUIRE(copied.storage);
+    const auto& local = *sink->records[4];
+    REQUIRE(local.tag == "LOCAL");
+    REQUIRE(local.site->tag.empty());
+    REQUIRE(local.storage);
+  }
+}
@@ -0,0 +1,110 @@
+#include "nvlog/backtrace.h"
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Explanation
+// # Ordering:
+//
+// Buffered records are handed back oldest first, and the ring is empty
+// after a flush.
+//
+// # Capacity:
+//
+// A full ring drops its oldest record for each new one and reports it;
+// records above ```buffer_level``` are not buffered at all.
+//
+// # Per-thread flush:
+//
+// An error only flushes the ring of its own thread, the other threads
+// keep their context for their own error.
+//
+// # Idle rings:
+//
+// A ring without records for ```idle_timeout``` is dropped with its
+// records, so exited threads don't keep a ring forever.
+
+namespace {
+
+nvlog::LogMessagePtr MakeMessage(
+    const std::string& thread_id, const std::string& message, int seconds = 0,
+    nvlog::LogLevel level = nvlog::LogLevel::Debug) {
+  return nvlog::MakeLogMessage(
+      std::chrono::system_clock::time_point(std::chrono::seconds(seconds)),
+      level, "BT", message, __FILE__, __LINE__, thread_id);
+}
+
+std::vector<std::string> Flush(nvlog::BacktraceBuffer& buffer,
+                               const std::string& thread_id) {
+  std::vector<std::string> messages;
+  auto trigger = MakeMessage(thread_id, "error", 0, nvlog::LogLevel::Error);
+  buffer.Flush(*trigger, [&messages](const nvlog::LogMessagePtr& record) {
+    messages.push_back(record->message);
+  });
+  return messages;
+}
+
+}  // namespace
+
+TEST_CASE("Backtrace Test") {
+  nvlog::BacktraceOptions options;
+  options.capacity = 4;
+  size_t dropped = 0;
+
+  SECTION("Ordering") {
+    nvlog::BacktraceBuffer buffer(options);
+    for (int i = 0; i < 3; ++i) {
+      REQUIRE(buffer.Offer(MakeMessage("1", std::to_string(i)), dropped));
+      REQUIRE(dropped == 0);
+    }
+    REQUIRE(Flush(buffer, "1") == std::vector<std::string>{"0", "1", "2"});
+    REQUIRE(Flush(buffer, "1").empty());
+  }
+
+  SECTION("Capacity") {
+    nvlog::BacktraceBuffer buffer(options);
+    size_t total = 0;
+    for (int i = 0; i < 7; ++i) {
+      REQUIRE(buffer.Offer(MakeMessage("1", std::to_string(i)), dropped));
+      total += dropped;
+    }
+    REQUIRE(total == 3);
+    REQUIRE(Flush(buffer, "1") ==
+            std::vector<std::string>{"3", "4", "5", "6"});
+
+    REQUIRE_FALSE(buffer.Offer(
+        MakeMessage("1", "info", 0, nvlog::LogLevel::Info), dropped));
+    REQUIRE(buffer.IsTrigger(
+        *MakeMessage("1", "error", 0, nvlog::LogLevel::Error)));
+  }
+
+  SECTION("Per-thread flush") {
+    nvlog::BacktraceBuffer buffer(options);
+    buffer.Offer(MakeMessage("1", "a1"), dropped);
+    buffer.Offer(MakeMessage("2", "b1"), dropped);
+    buffer.Offer(MakeMessage("1", "a2"), dropped);
+    buffer.Offer(MakeMessage("2", "b2"), dropped);
+
+    REQUIRE(Flush(buffer, "1") == std::vector<std::string>{"a1", "a2"});
+    REQUIRE(Flush(buffer, "2") == std::vector<std::string>{"b1", "b2"});
+    REQUIRE(Flush(buffer, "3").empty());
+  }
+
+  SECTION("Idle rings") {
+    options.idle_timeout = std::chrono::seconds(10);
+    nvlog::BacktraceBuffer buffer(options);
+    buffer.Offer(MakeMessage("exited", "old 1", 100), dropped);
+    buffer.Offer(MakeMessage("exited", "old 2", 101), dropped);
+    buffer.Offer(MakeMessage("alive", "a1", 105), dropped);
+    REQUIRE(buffer.RingCount() == 2);
+
+    // Sweeps once per timeout: ```exited``` is idle since 101
+    buffer.Offer(MakeMessage("alive", "a2", 111), dropped);
+    REQUIRE(dropped == 2);
+    REQUIRE(buffer.RingCount() == 1);
+    REQUIRE(Flush(buffer, "exited").empty());
+    REQUIRE(Flush(buffer, "alive") == std::vector<std::string>{"a1", "a2"});
+  }
+}
@@ -0,0 +1,67 @@
+#include "nvlog/clock.h"
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+// Explanation
+// # Conversion accuracy:
+//
+// Ticks read next to ```system_clock::now()``` must convert to a time point
+// within a bound of it, right after calibration and after the converter
+// ran a while and recalibrated.
+//
+// # Monotonic:
+//
+// Later ticks never convert to an earlier time between recalibrations.
+
+namespace {
+
+int64_t ErrorUs(const nvlog::TickConverter& converter) {
+  uint64_t ticks = nvlog::ReadTicks();
+  auto now = std::chrono::system_clock::now();
+  auto converted = converter.ToTimePoint(ticks);
+  return std::llabs(
+      std::chrono::duration_cast<std::chrono::microseconds>(converted - now)
+          .count());
+}
+
+}  // namespace
+
+TEST_CASE("TickConverter Test") {
+  nvlog::TickConverter converter(std::chrono::milliseconds(50));
+  REQUIRE(converter.NsPerTick() > 0);
+
+  SECTION("Accurate after calibration") {
+#if NVLOG_HAS_TSC
+    REQUIRE(ErrorUs(converter) < 500);
+#else
+    // CLOCK_MONOTONIC_COARSE resolution is a scheduler tick
+    REQUIRE(ErrorUs(converter) < 20000);
+#endif
+  }
+
+  SECTION("Bounded drift with recalibration") {
+    for (int i = 0; i < 10; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      converter.MaybeRecalibrate(nvlog::ReadTicks());
+    }
+#if NVLOG_HAS_TSC
+    REQUIRE(ErrorUs(converter) < 500);
+#else
+    REQUIRE(ErrorUs(converter) < 20000);
+#endif
+  }
+
+  SECTION("Monotonic between recalibrations") {
+    bool monotonic = true;
+    auto previous = converter.ToTimePoint(nvlog::ReadTicks());
+    for (int i = 0; i < 10000; ++i) {
+      auto current = converter.ToTimePoint(nvlog::ReadTicks());
+      monotonic = monotonic && current >= previous;
+      previous = current;
+    }
+    REQUIRE(monotonic);
+  }
+}
@@ -0,0 +1,303 @@
+#include "nvlog/crash_handler.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvlog/defered_file_sink.h"
+#include "nvlog/emergency_writer.h"
+
+// Explanation
+// # EmergencyWriter:
+//
+// A record is written as ```LEVEL [seconds.micros] tid=.. file:line [tag]
+// message```, a message longer than the stack buffer is written whole. A
+// record still holding raw ticks is written with ```[ticks=..]```.
+//
+// # EmergencyDrain:
+//
+// Records still queued in an ```AsyncSink``` go to the fallback fd; the
+// unwritten buffer of a ```DeferredFileSink``` is appended to its file.
+// Draining a running sink over and over holds its worker off for each walk
+// only: every record is still processed once.
+//
+// # Signal:
+//
+// A forked child raises SIGSEGV with records buffered in a file sink: the
+// records reach the file and the child still dies of SIGSEGV.
+//
+// # Fatal record:
+//
+// With ```abort_on_fatal``` a forked child aborts once the engine is shut
+// down and every record is in the file. Without it the records are in the
+// file when the ```Fatal``` call returns and the engine keeps running.
+
+namespace {
+
+std::string LogPath(const std::string& name) {
+  return "/tmp/nvlog_test_" + std::to_string(::getpid()) + "_" + name;
+}
+
+std::string ReadFile(const std::string& filename) {
+  std::ifstream file(filename);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+std::string ReadPipe(int fd) {
+  std::string text;
+  char buffer[4096];
+  ssize_t n;
+  while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+    text.append(buffer, static_cast<size_t>(n));
+  }
+  return text;
+}
+
+nvlog::LogMessagePtr MakeMessage(const std::string& message) {
+  return nvlog::MakeLogMessage(std::chrono::system_clock::now(),
+                               nvlog::LogLevel::Info, "CRASH", message,
+                               "crash.cc", 1, "1");
+}
+
+// Never started, every record stays queued
+class QueuedSink : public nvlog::AsyncSink {
+ protected:
+  void Process(const nvlog::LogMessagePtr& /*log_message*/) override {}
+};
+
+class CountingSink : public nvlog::AsyncSink {
+ public:
+  std::atomic<int> count{0};
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& /*log_message*/) override {
+    count.fetch_add(1);
+  }
+};
+
+// Large buffer and interval, records stay in the sink buffer
+std::shared_ptr<nvlog::DeferredFileSink> BufferedSink(
+    const std::string& filename) {
+  return std::make_shared<nvlog::DeferredFileSink>(
+      filename, 1 << 20, std::chrono::seconds(3600));
+}
+
+bool WaitProcessed(const nvlog::Sink& sink, uint64_t count) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (sink.Stats().processed < count) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// Child side: default dispositions, so the test framework handlers
+// don't report the crash, and no core dump
+void PrepareChild() {
+  struct rlimit limit = {0, 0};
+  ::setrlimit(RLIMIT_CORE, &limit);
+  ::signal(SIGSEGV, SIG_DFL);
+  ::signal(SIGABRT, SIG_DFL);
+}
+
+}  // namespace
+
+TEST_CASE("EmergencyWriter Test") {
+  int fds[2];
+  REQUIRE(::pipe(fds) == 0);
+
+  SECTION("Format") {
+    nvlog::LogMessage log_message(
+        std::chrono::system_clock::time_point(std::chrono::seconds(12) +
+                                              std::chrono::microseconds(34)),
+        nvlog::LogLevel::Error, "TAG", "hello", "main.cc", 7, "99");
+    {
+      nvlog::EmergencyWriter writer(fds[1]);
+      writer.Write(log_message);
+    }
+    ::close(fds[1]);
+    REQUIRE(ReadPipe(fds[0]) ==
+            "ERROR [12.000034] tid=99 main.cc:7 [TAG] hello\n");
+  }
+
+  SECTION("Long message") {
+    std::string message(3000, 'x');
+    nvlog::LogMessage log_message(std::chrono::system_clock::time_point(),
+                                  nvlog::LogLevel::Fatal, "", message, "a.cc",
+                                  1, "1");
+    {
+      nvlog::EmergencyWriter writer(fds[1]);
+      writer.Write(log_message);
+    }
+    ::close(fds[1]);
+    REQUIRE(ReadPipe(fds[0]) ==
+            "CRITICAL [0.000000] tid=1 a.cc:1 [] " + message + "\n");
+  }
+
+  SECTION("Ticks") {
+    nvlog::LogMessage log_message(std::chrono::system_clock::time_point(),
+                                  nvlog::LogLevel::Info, "TAG", "queued",
+                                  "main.cc", 7, "99");
+    log_message.ticks = 123456789;
+    {
+      nvlog::EmergencyWriter writer(fds[1]);
+      writer.Write(log_message);
+    }
+    ::close(fds[1]);
+    REQUIRE(ReadPipe(fds[0]) ==
+            "INFO [ticks=123456789] tid=99 main.cc:7 [TAG] queued\n");
+  }
+
+  ::close(fds[0]);
+}
+
+TEST_CASE("EmergencyDrain Test") {
+  SECTION("AsyncSink") {
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    QueuedSink sink;
+    sink.Log(MakeMessage("first"));
+    sink.Log(MakeMessage("second"));
+    sink.EmergencyDrain(fds[1]);
+    ::close(fds[1]);
+
+    std::string text = ReadPipe(fds[0]);
+    ::close(fds[0]);
+    auto first = text.find("[CRASH] first\n");
+    auto second = text.find("[CRASH] second\n");
+    REQUIRE(first != std::string::npos);
+    REQUIRE(second != std::string::npos);
+    REQUIRE(first < second);
+  }
+
+  SECTION("DeferredFileSink") {
+    std::string filename = LogPath("drain.log");
+    ::unlink(filename.c_str());
+    auto sink = BufferedSink(filename);
+    sink->Start();
+    sink->Log(MakeMessage("buffered"));
+    REQUIRE(WaitProcessed(*sink, 1));
+    REQUIRE(ReadFile(filename).empty());
+
+    sink->EmergencyDrain(-1);
+    REQUIRE(ReadFile(filename).find("buffered") != std::string::npos);
+    sink->Shutdown();
+    ::unlink(filename.c_str());
+  }
+
+  SECTION("Running sink") {
+    int fd = ::open("/dev/null", O_WRONLY);
+    REQUIRE(fd >= 0);
+    CountingSink sink;
+    sink.Start();
+    constexpr int kRecords = 2000;
+    for (int i = 0; i < kRecords; ++i) {
+      sink.Log(MakeMessage("record " + std::to_string(i)));
+      if (i % 10 == 0) {
+        sink.EmergencyDrain(fd);
+      }
+    }
+    sink.Shutdown();
+    ::close(fd);
+    REQUIRE(sink.count.load() == kRecords);
+  }
+}
+
+TEST_CASE("CrashHandler Test") {
+  std::string filename = LogPath("crash.log");
+  ::unlink(filename.c_str());
+
+  SECTION("Signal") {
+    pid_t child = ::fork();
+    if (child == 0) {
+      PrepareChild();
+      auto sink = BufferedSink(filename);
+      std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+      auto logger = std::make_shared<nvlog::Logger>(
+          std::make_shared<nvlog::limiters::NullLimiter>(), sinks);
+      logger->StartEngine();
+      logger->Log(nvlog::LogLevel::Info, "before crash", "CRASH", __FILE__,
+                  __LINE__);
+      if (!WaitProcessed(*sink, 1)) {
+        ::_exit(1);
+      }
+      nvlog::CrashHandler::Install(logger);
+      ::raise(SIGSEGV);
+      ::_exit(2);
+    }
+    int status = 0;
+    REQUIRE(::waitpid(child, &status, 0) == child);
+    REQUIRE(WIFSIGNALED(status));
+    REQUIRE(WTERMSIG(status) == SIGSEGV);
+    REQUIRE(ReadFile(filename).find("before crash") != std::string::npos);
+  }
+
+  SECTION("Fatal record with abort") {
+    pid_t child = ::fork();
+    if (child == 0) {
+      PrepareChild();
+      auto sink = BufferedSink(filename);
+      std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+      auto logger = std::make_shared<nvlog::Logger>(
+          std::make_shared<nvlog::limiters::NullLimiter>(), sinks);
+      logger->StartEngine();
+      nvlog::CrashHandler::Install(logger);
+      logger->Log(nvlog::LogLevel::Info, "before fatal", "CRASH", __FILE__,
+                  __LINE__);
+      logger->Log(nvlog::LogLevel::Fatal, "fatal record", "CRASH", __FILE__,
+                  __LINE__);
+      ::_exit(2);
+    }
+    int status = 0;
+    REQUIRE(::waitpid(child, &status, 0) == child);
+    REQUIRE(WIFSIGNALED(status));
+    REQUIRE(WTERMSIG(status) == SIGABRT);
+    std::string text = ReadFile(filename);
+    REQUIRE(text.find("before fatal") != std::string::npos);
+    REQUIRE(text.find("fatal record") != std::string::npos);
+  }
+
+  SECTION("Fatal record without abort") {
+    auto sink = BufferedSink(filename);
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    auto logger = std::make_shared<nvlog::Logger>(
+        std::make_shared<nvlog::limiters::NullLimiter>(), sinks);
+    logger->StartEngine();
+    nvlog::CrashHandlerOptions options;
+    options.signals.clear();
+    options.abort_on_fatal = false;
+    nvlog::CrashHandler::Install(logger, options);
+
+    logger->Log(nvlog::LogLevel::Info, "before fatal", "CRASH", __FILE__,
+                __LINE__);
+    logger->Log(nvlog::LogLevel::Fatal, "fatal record", "CRASH", __FILE__,
+                __LINE__);
+    std::string text = ReadFile(filename);
+    REQUIRE(text.find("before fatal") != std::string::npos);
+    REQUIRE(text.find("fatal record") != std::string::npos);
+    REQUIRE(logger->IsRun());
+
+    logger->Log(nvlog::LogLevel::Info, "after fatal", "CRASH", __FILE__,
+                __LINE__);
+    nvlog::CrashHandler::Uninstall();
+    logger->ShutdownEngine();
+    REQUIRE(ReadFile(filename).find("after fatal") != std::string::npos);
+  }
+
+  ::unlink(filename.c_str());
+}
@@ -0,0 +1,110 @@
+#include "nvlog/executor.h"
+
+#include <catch2/catch_all.hpp>
+#include <thread>
+#include <vector>
+
+#include "nvlog/sink.h"
+
+// Explanation
+// # Strand ordering:
+//
+// Several sinks share an executor with more threads than one,
+// each sink must still process every message exactly once, in order,
+// and never concurrently with itself.
+//
+// # Executor shut down first:
+//
+// Once the executor is shut down it refuses new tasks. A sink still
+// logging to it must neither hang in its own shutdown nor lose the
+// records queued since, they are written in order by ```Shutdown()```.
+
+namespace {
+
+class OrderSink : public nvlog::AsyncSink {
+ public:
+  bool Ordered() const {
+    return ordered_;
+  }
+  int Count() const {
+    return count_;
+  }
+  bool Overlapped() const {
+    return overlapped_;
+  }
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    if (busy_.exchange(true)) {
+      overlapped_ = true;
+    }
+    int value = std::stoi(log_message->message);
+    ordered_ = ordered_ && value == count_;
+    ++count_;
+    busy_.store(false);
+  }
+
+ private:
+  std::atomic<bool> busy_{false};
+  bool overlapped_ = false;
+  bool ordered_ = true;
+  int count_ = 0;
+};
+
+nvlog::LogMessagePtr Numbered(int i) {
+  return nvlog::MakeLogMessage(std::chrono::system_clock::now(),
+                               nvlog::LogLevel::Info, "", std::to_string(i),
+                               __FILE__, __LINE__, nvlog::GetThreadId());
+}
+
+}  // namespace
+
+TEST_CASE("Executor strand Test") {
+  auto executor = std::make_shared<nvlog::Executor>(3);
+  std::vector<std::shared_ptr<OrderSink>> sinks;
+  for (int i = 0; i < 4; ++i) {
+    sinks.push_back(std::make_shared<OrderSink>());
+    sinks.back()->SetExecutor(executor);
+    sinks.back()->Start();
+  }
+
+  const int messages = 5000;
+  for (int i = 0; i < messages; ++i) {
+    auto log_message = nvlog::MakeLogMessage(
+        std::chrono::system_clock::now(), nvlog::LogLevel::Info, "",
+        std::to_string(i), __FILE__, __LINE__, nvlog::GetThreadId());
+    for (auto& sink : sinks) {
+      sink->Log(log_message);
+    }
+  }
+
+  for (auto& sink : sinks) {
+    sink->Shutdown();
+    REQUIRE(sink->Count() == messages);
+    REQUIRE(sink->Ordered());
+    REQUIRE_FALSE(sink->Overlapped());
+  }
+}
+
+TEST_CASE("Executor shutdown before sink Test") {
+  auto executor = std::make_shared<nvlog::Executor>(2);
+  auto sink = std::make_shared<OrderSink>();
+  sink->SetExecutor(executor);
+  sink->Start();
+
+  const int messages = 1000;
+  for (int i = 0; i < messages / 2; ++i) {
+    sink->Log(Numbered(i));
+  }
+  executor->Shutdown();
+  REQUIRE(executor->IsStopped());
+  REQUIRE_FALSE(executor->Submit([]() {}));
+  for (int i = messages / 2; i < messages; ++i) {
+    sink->Log(Numbered(i));
+  }
+
+  sink->Shutdown();
+  REQUIRE(sink->Count() == messages);
+  REQUIRE(sink->Ordered());
+  REQUIRE_FALSE(sink->IsRun());
+}
@@ -0,0 +1,74 @@
+#include "nvlog/flight_recorder_sink.h"
+
+#include <unistd.h>
+
+#include <catch2/catch_all.hpp>
+#include <string>
+#include <vector>
+
+// Explanation
+// # Wrap around:
+//
+// Ring is written far past its capacity, reading it back must return the
+// newest records only, in order and without a gap.
+//
+// # Reopen:
+//
+// Ring reopened with the same capacity keeps its records and appends.
+
+namespace {
+
+nvlog::LogMessagePtr MakeMessage(int i) {
+  return nvlog::MakeLogMessage(
+      std::chrono::system_clock::now(), nvlog::LogLevel::Debug, "FR",
+      "record " + std::to_string(i), __FILE__, __LINE__, nvlog::GetThreadId());
+}
+
+std::vector<std::string> ReadAll(const std::string& filename) {
+  std::vector<std::string> messages;
+  REQUIRE(nvlog::ReadFlightRecorder(
+      filename, [&messages](const nvlog::LogMessage& log_message) {
+        messages.push_back(log_message.message);
+      }));
+  return messages;
+}
+
+}  // namespace
+
+TEST_CASE("FlightRecorderSink Test") {
+  std::string filename =
+      "/tmp/nvlog_fr_test_" + std::to_string(::getpid()) + ".ring";
+  ::unlink(filename.c_str());
+
+  SECTION("Wrap around keeps the newest records") {
+    {
+      nvlog::FlightRecorderSink sink(filename, 8 * 1024);
+      for (int i = 0; i < 1000; ++i) {
+        sink.Log(MakeMessage(i));
+      }
+    }
+    auto messages = ReadAll(filename);
+    REQUIRE(!messages.empty());
+    REQUIRE(messages.size() < 1000);
+    REQUIRE(messages.back() == "record 999");
+    int first = 1000 - static_cast<int>(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i) {
+      REQUIRE(messages[i] == "record " + std::to_string(first + i));
+    }
+  }
+
+  SECTION("Reopen appends to the existing ring") {
+    {
+      nvlog::FlightRecorderSink sink(filename, 8 * 1024);
+      sink.Log(MakeMessage(1));
+    }
+    {
+      nvlog::FlightRecorderSink sink(filename, 8 * 1024);
+      sink.Log(MakeMessage(2));
+    }
+    REQUIRE(ReadAll(filename) ==
+            std::vector<std::string>{"record 1", "record 2"});
+  }
+
+  ::unlink(filename.c_str());
+}
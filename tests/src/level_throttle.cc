@@ -0,0 +1,177 @@
+#include "nvlog/level_throttle.h"
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvlog/logger.h"
+
+// Explanation
+// # Hysteresis:
+//
+// The level goes up one step per sample while the backlog is over the high
+// watermark and not shrinking, stays put between the watermarks and comes
+// back down one step per hold once under the low watermark.
+//
+// # Logger level:
+//
+// Steps start from the logger level and never go past ```max_level```;
+// lowering back to the logger level lifts the throttle.
+//
+// # Logger:
+//
+// A stuck sink makes the throttle drop Debug records, a Warning record
+// reports each change, and the level is restored once the sink drains.
+// A throttle replaced on the running engine takes over from Trace.
+
+namespace {
+
+constexpr uint64_t kMs = 1000000;
+
+nvlog::ThrottleSample Sample(uint64_t backlog, uint64_t enqueued,
+                             uint64_t now_ms) {
+  nvlog::ThrottleSample sample;
+  sample.backlog = backlog;
+  sample.enqueued = enqueued;
+  sample.now_ns = now_ms * kMs;
+  return sample;
+}
+
+class GateSink : public nvlog::AsyncSink {
+ public:
+  void Open() {
+    open_.store(true);
+  }
+
+  std::vector<std::string> Notices() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return notices_;
+  }
+
+  std::atomic<int> debug{0};
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    while (!open_.load()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    if (log_message->tag == "nvlog") {
+      std::lock_guard<std::mutex> lock(mu_);
+      notices_.push_back(log_message->message);
+    } else if (log_message->log_level == nvlog::LogLevel::Debug) {
+      debug.fetch_add(1);
+    }
+  }
+
+ private:
+  std::atomic<bool> open_{false};
+  std::mutex mu_;
+  std::vector<std::string> notices_;
+};
+
+template <typename Fn>
+bool WaitFor(Fn done) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST_CASE("LevelThrottle Test") {
+  nvlog::LevelThrottleOptions options;
+  options.high_watermark = 1000;
+  options.low_watermark = 100;
+  options.max_level = nvlog::LogLevel::Warning;
+  options.hold = std::chrono::milliseconds(50);
+
+  SECTION("Hysteresis") {
+    nvlog::LevelThrottle throttle(options);
+    nvlog::LogLevel level = nvlog::LogLevel::Trace;
+    auto base = nvlog::LogLevel::Trace;
+
+    REQUIRE_FALSE(throttle.Evaluate(Sample(500, 500, 0), base, level));
+    REQUIRE(throttle.Evaluate(Sample(1500, 2000, 10), base, level));
+    REQUIRE(level == nvlog::LogLevel::Debug);
+    REQUIRE(throttle.Evaluate(Sample(1600, 2200, 20), base, level));
+    REQUIRE(level == nvlog::LogLevel::Info);
+    // Over the high watermark but draining: no further step
+    REQUIRE_FALSE(throttle.Evaluate(Sample(1200, 2300, 30), base, level));
+    REQUIRE(throttle.DrainRate() == 50000);
+    // Between the watermarks
+    REQUIRE_FALSE(throttle.Evaluate(Sample(500, 2300, 100), base, level));
+    // Under the low watermark, one step per hold
+    REQUIRE(throttle.Evaluate(Sample(50, 2300, 110), base, level));
+    REQUIRE(level == nvlog::LogLevel::Debug);
+    REQUIRE_FALSE(throttle.Evaluate(Sample(0, 2300, 120), base, level));
+    REQUIRE(throttle.Evaluate(Sample(0, 2300, 160), base, level));
+    REQUIRE(level == nvlog::LogLevel::Trace);
+    REQUIRE_FALSE(throttle.Evaluate(Sample(0, 2300, 300), base, level));
+  }
+
+  SECTION("Logger level") {
+    nvlog::LevelThrottle throttle(options);
+    nvlog::LogLevel level = nvlog::LogLevel::Trace;
+    auto base = nvlog::LogLevel::Info;
+
+    REQUIRE(throttle.Evaluate(Sample(2000, 2000, 10), base, level));
+    REQUIRE(level == nvlog::LogLevel::Warning);
+    REQUIRE_FALSE(throttle.Evaluate(Sample(3000, 3000, 20), base, level));
+    REQUIRE(throttle.Evaluate(Sample(0, 3000, 100), base, level));
+    REQUIRE(level == nvlog::LogLevel::Trace);
+  }
+
+  SECTION("Logger") {
+    auto sink = std::make_shared<GateSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    options.high_watermark = 100;
+    options.low_watermark = 10;
+    options.max_level = nvlog::LogLevel::Info;
+    options.interval = std::chrono::milliseconds(5);
+    options.hold = std::chrono::milliseconds(0);
+    logger.SetLevelThrottle(options);
+    logger.StartEngine();
+
+    for (int i = 0; i < 200; ++i) {
+      logger.Log(nvlog::LogLevel::Debug, "flood", "THROTTLE", __FILE__,
+                 __LINE__);
+    }
+    REQUIRE(WaitFor([&logger]() {
+      return logger.GetThrottleLevel() == nvlog::LogLevel::Info;
+    }));
+    auto before = logger.GetStats().enqueued;
+    logger.Log(nvlog::LogLevel::Debug, "dropped", "THROTTLE", __FILE__,
+               __LINE__);
+    logger.Log(nvlog::LogLevel::Info, "kept", "THROTTLE", __FILE__, __LINE__);
+    REQUIRE(logger.GetStats().enqueued == before + 1);
+
+    options.max_level = nvlog::LogLevel::Debug;
+    logger.SetLevelThrottle(options);
+    REQUIRE(WaitFor([&logger]() {
+      return logger.GetThrottleLevel() == nvlog::LogLevel::Debug;
+    }));
+
+    sink->Open();
+    REQUIRE(WaitFor([&logger]() {
+      return logger.GetThrottleLevel() == nvlog::LogLevel::Trace;
+    }));
+    logger.ShutdownEngine();
+
+    REQUIRE(sink->debug.load() == 200);
+    auto notices = sink->Notices();
+    REQUIRE(notices.size() >= 2);
+    REQUIRE(notices.front().rfind("Log level throttled to DEBUG", 0) == 0);
+    REQUIRE(notices.back().rfind("Log level restored to TRACE", 0) == 0);
+  }
+}
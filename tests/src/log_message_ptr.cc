@@ -0,0 +1,62 @@
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <thread>
+#include <vector>
+
+#include "nvlog/declare.h"
+
+// Explanation
+// # Ownership:
+//
+// Copies add a reference, moves don't. ```Share(n)``` adds the references
+// of ```n``` owners at once, each taken with ```Adopt()```, and the record
+// is freed by whichever owner releases last, from any thread.
+
+namespace {
+
+nvlog::LogMessagePtr MakeMessage() {
+  return nvlog::MakeLogMessage(std::chrono::system_clock::now(),
+                               nvlog::LogLevel::Info, "TAG", "message",
+                               __FILE__, __LINE__, nvlog::GetThreadId());
+}
+
+}  // namespace
+
+TEST_CASE("LogMessagePtr Test") {
+  SECTION("Ownership") {
+    nvlog::LogMessagePtr ptr = MakeMessage();
+    REQUIRE(ptr->refs.load() == 1);
+
+    nvlog::LogMessagePtr copy = ptr;
+    REQUIRE(ptr->refs.load() == 2);
+    nvlog::LogMessagePtr moved = std::move(copy);
+    REQUIRE_FALSE(copy);
+    REQUIRE(ptr->refs.load() == 2);
+    moved.reset();
+    REQUIRE(ptr->refs.load() == 1);
+  }
+
+  SECTION("Shared release") {
+    std::atomic<int> seen{0};
+    for (int round = 0; round < 100; ++round) {
+      nvlog::LogMessagePtr ptr = MakeMessage();
+      const int owners = 4;
+      ptr.Share(owners);
+      std::vector<std::thread> threads;
+      for (int i = 0; i < owners; ++i) {
+        threads.emplace_back(
+            [&seen, owned = nvlog::LogMessagePtr::Adopt(ptr.get())]() mutable {
+              if (owned->message == "message") {
+                seen.fetch_add(1);
+              }
+              owned.reset();
+            });
+      }
+      ptr.reset();
+      for (auto& thread : threads) {
+        thread.join();
+      }
+    }
+    REQUIRE(seen.load() == 400);
+  }
+}
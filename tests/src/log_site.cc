@@ -0,0 +1,100 @@
+#include "nvlog/log_site.h"
+
+#include <catch2/catch_all.hpp>
+#include <cstring>
+#include <vector>
+
+#include "nvlog/logger.h"
+
+// Explanation
+// # Static metadata:
+//
+// Records of a call site point at its ```static constexpr``` ```LogSite```:
+// basename computed at compile time, function, line and level come from
+// the site and a literal tag of the site is referenced in place, not
+// copied.
+//
+// # Owned text:
+//
+// A tag given at the call (a ```std::string``` or a ```char``` buffer),
+// and records built without a site, own a copy.
+
+namespace {
+
+static_assert(nvlog::Basename("/a/b/file.cc") == "file.cc");
+static_assert(nvlog::Basename("file.cc") == "file.cc");
+static_assert(nvlog::Basename("C:\\src\\file.cc") == "file.cc");
+
+class KeepSink : public nvlog::SyncSink {
+ public:
+  std::vector<nvlog::LogMessagePtr> records;
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    records.push_back(log_message);
+  }
+};
+
+void LogFromHelper(const nvlog::Logger& logger) {
+  NVLOG_SITE(nvlog::LogLevel::Info, "HELPER");
+  logger.Log(nvlog_site, "helper");
+}
+
+}  // namespace
+
+TEST_CASE("LogSite Test") {
+  auto sink = std::make_shared<KeepSink>();
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+  nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                       sinks);
+  logger.StartEngine();
+
+  SECTION("Static metadata") {
+    static constexpr char kTag[] = "DB";
+    NVLOG_SITE(nvlog::LogLevel::Warning, NVLOG_SITE_TAG(kTag));
+    logger.Log(nvlog_site, "literal tag");
+    {
+      // Runtime tag: not kept in the site
+      NVLOG_SITE(nvlog::LogLevel::Warning, NVLOG_SITE_TAG(std::string("RT")));
+      logger.Log(nvlog_site, "no tag");
+    }
+    LogFromHelper(logger);
+
+    REQUIRE(sink->records.size() == 3);
+    const auto& record = *sink->records[0];
+    REQUIRE(record.site == &nvlog_site);
+    REQUIRE(record.log_level == nvlog::LogLevel::Warning);
+    REQUIRE(record.file == "log_site.cc");
+    REQUIRE(record.line == nvlog_site.line);
+    REQUIRE(record.tag.data() == kTag);
+    REQUIRE(record.file.data() == nvlog_site.file.data());
+    REQUIRE_FALSE(record.storage);
+    REQUIRE(sink->records[1]->tag.empty());
+    REQUIRE(std::strcmp(sink->records[2]->site->function, "LogFromHelper") ==
+            0);
+    REQUIRE(sink->records[2]->tag == "HELPER");
+  }
+
+  SECTION("Owned text") {
+    NVLOG_SITE(nvlog::LogLevel::Info, "");
+    std::string tag = "W#" + std::to_string(7);
+    logger.Log(nvlog_site, "dynamic tag", tag);
+    char buffer[32] = "worker-7";
+    logger.Log(nvlog_site, "buffer tag", buffer);
+    std::memset(buffer, 'x', sizeof(buffer) - 1);
+    logger.Log(nvlog::LogLevel::Info, "legacy", "LEGACY", "/a/b/legacy.cc", 12);
+
+    REQUIRE(sink->records.size() == 3);
+    tag.clear();
+    REQUIRE(sink->records[0]->tag == "W#7");
+    REQUIRE(sink->records[0]->file == "log_site.cc");
+    REQUIRE(sink->records[0]->storage);
+    REQUIRE(sink->records[1]->tag == "worker-7");
+    REQUIRE(sink->records[1]->storage);
+    REQUIRE(sink->records[2]->site == nullptr);
+    REQUIRE(sink->records[2]->tag == "LEGACY");
+    REQUIRE(sink->records[2]->file == "/a/b/legacy.cc");
+  }
+
+  logger.ShutdownEngine();
+}
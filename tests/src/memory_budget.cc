@@ -0,0 +1,168 @@
+#include "nvlog/memory_budget.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "nvlog/defered_file_sink.h"
+#include "nvlog/logger.h"
+
+// Explanation
+// # Shed:
+//
+// A sink stuck on its first record lets the queue grow until the budget
+// is full. Low level records are shed first and errors still get in with
+// the reserved part of the limit. Once the sink writes again and the
+// logger is shut down nothing is left charged.
+//
+// # Block:
+//
+// With ```BudgetPolicy::Block``` producers wait for the sink instead of
+// shedding, every record is delivered.
+//
+// # Sink buffer:
+//
+// Text held in the ```DeferredFileSink``` write buffer counts against the
+// budget until it is flushed.
+
+namespace {
+
+class GateSink : public nvlog::AsyncSink {
+ public:
+  void Open() {
+    open_.store(true);
+  }
+
+  size_t Count() const {
+    return count_.load();
+  }
+
+  size_t Errors() const {
+    return errors_.load();
+  }
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    while (!open_.load()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    if (log_message->log_level == nvlog::LogLevel::Error) {
+      errors_.fetch_add(1);
+    }
+    count_.fetch_add(1);
+  }
+
+ private:
+  std::atomic<bool> open_{false};
+  std::atomic<size_t> count_{0};
+  std::atomic<size_t> errors_{0};
+};
+
+std::string Payload() {
+  return std::string(1000, 'x');
+}
+
+}  // namespace
+
+TEST_CASE("MemoryBudget Test") {
+  SECTION("Shed") {
+    auto sink = std::make_shared<GateSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    nvlog::MemoryBudgetOptions options;
+    options.limit_bytes = 64 * 1024;
+    logger.SetMemoryBudget(options);
+    logger.StartEngine();
+
+    for (int i = 0; i < 1000; ++i) {
+      logger.Log(nvlog::LogLevel::Info, Payload(), "MEM", __FILE__, __LINE__);
+    }
+    auto stats = logger.GetStats();
+    REQUIRE(stats.budget_shed > 0);
+    REQUIRE(stats.budget_bytes <= options.limit_bytes * 3 / 4);
+    uint64_t shed_info = stats.budget_shed;
+
+    for (int i = 0; i < 10; ++i) {
+      logger.Log(nvlog::LogLevel::Error, Payload(), "MEM", __FILE__,
+                 __LINE__);
+    }
+    stats = logger.GetStats();
+    REQUIRE(stats.budget_shed == shed_info);
+    REQUIRE(stats.budget_high_water <= options.limit_bytes);
+    REQUIRE(stats.budget_high_water >= options.limit_bytes / 2);
+    REQUIRE(stats.ToText().find("nvlog_budget_high_water_bytes ") !=
+            std::string::npos);
+
+    sink->Open();
+    logger.ShutdownEngine();
+    stats = logger.GetStats();
+    REQUIRE(sink->Count() == stats.enqueued);
+    REQUIRE(sink->Count() + stats.budget_shed == 1010);
+    REQUIRE(sink->Errors() == 10);
+    REQUIRE(stats.budget_bytes == 0);
+  }
+
+  SECTION("Block") {
+    auto sink = std::make_shared<GateSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    nvlog::MemoryBudgetOptions options;
+    options.limit_bytes = 16 * 1024;
+    options.policy = nvlog::BudgetPolicy::Block;
+    options.max_block = std::chrono::seconds(10);
+    logger.SetMemoryBudget(options);
+    logger.StartEngine();
+
+    std::thread opener([&sink]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      sink->Open();
+    });
+    for (int i = 0; i < 500; ++i) {
+      logger.Log(nvlog::LogLevel::Info, Payload(), "MEM", __FILE__, __LINE__);
+    }
+    opener.join();
+    logger.ShutdownEngine();
+
+    auto stats = logger.GetStats();
+    REQUIRE(stats.budget_shed == 0);
+    REQUIRE(sink->Count() == 500);
+    REQUIRE(stats.budget_high_water <= options.limit_bytes);
+    REQUIRE(stats.budget_bytes == 0);
+  }
+
+  SECTION("Sink buffer") {
+    std::string filename =
+        "/tmp/nvlog_test_" + std::to_string(::getpid()) + "_budget.log";
+    ::unlink(filename.c_str());
+    auto sink = std::make_shared<nvlog::DeferredFileSink>(
+        filename, 1024 * 1024, std::chrono::seconds(60));
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.SetMemoryBudget();
+    logger.StartEngine();
+
+    for (int i = 0; i < 100; ++i) {
+      logger.Log(nvlog::LogLevel::Info, Payload(), "MEM", __FILE__, __LINE__);
+    }
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (sink->Stats().processed < 100 &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Records are freed, their text sits in the write buffer
+    REQUIRE(logger.GetStats().budget_bytes >= 100 * 1000);
+    REQUIRE(logger.GetStats().budget_bytes < 2 * 100 * 1000);
+
+    logger.ShutdownEngine();
+    REQUIRE(logger.GetStats().budget_bytes == 0);
+    ::unlink(filename.c_str());
+  }
+}
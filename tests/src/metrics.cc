@@ -0,0 +1,94 @@
+#include "nvlog/metrics.h"
+
+#include <catch2/catch_all.hpp>
+#include <thread>
+#include <vector>
+
+// Explanation
+// # Histogram buckets:
+//
+// Every value falls in a bucket whose upper bound is at least the value
+// and at most 25% above it, bucket index and bound are inverse.
+//
+// # Sharded counter and exposition:
+//
+// Counts from many threads add up, text exposition renders them with a
+// ```_sum``` per histogram and label values escaped.
+
+TEST_CASE("LatencyHistogram Test") {
+  SECTION("Bucket bounds") {
+    std::vector<uint64_t> values = {0,       1,       3,          4,
+                                    5,       7,       8,          1000,
+                                    1023,    1024,    123456789,  UINT64_MAX};
+    for (uint64_t value : values) {
+      int index = nvlog::LatencyHistogram::BucketIndex(value);
+      REQUIRE(index >= 0);
+      REQUIRE(index < nvlog::LatencyHistogram::kBuckets);
+      uint64_t bound = nvlog::LatencyHistogram::BucketUpperBound(index);
+      REQUIRE(bound >= value);
+      REQUIRE(static_cast<double>(bound) <=
+              static_cast<double>(value) * 1.25 + 1);
+      if (index > 0) {
+        REQUIRE(nvlog::LatencyHistogram::BucketUpperBound(index - 1) < value);
+      }
+    }
+  }
+
+  SECTION("Quantile") {
+    nvlog::LatencyHistogram histogram;
+    for (uint64_t i = 1; i <= 1000; ++i) {
+      histogram.Record(i * 1000);
+    }
+    auto snapshot = histogram.Snapshot();
+    REQUIRE(snapshot.count == 1000);
+    REQUIRE(snapshot.sum == 500500000);
+    uint64_t p50 = snapshot.Quantile(0.5);
+    REQUIRE(p50 >= 500000);
+    REQUIRE(p50 <= 625000);
+    REQUIRE(snapshot.Quantile(1.0) >= 1000000);
+  }
+}
+
+TEST_CASE("Metrics exposition Test") {
+  nvlog::ShardedCounter counter;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&counter]() {
+      for (int j = 0; j < 1000; ++j) {
+        counter.Add();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(counter.Load() == 8000);
+
+  nvlog::LoggerStats stats;
+  stats.enqueued = counter.Load();
+  nvlog::SinkStats sink;
+  sink.name = "console";
+  sink.processed = 42;
+  stats.sinks.push_back(sink);
+  nvlog::SinkStats socket;
+  socket.name = "unix:/tmp/a \"b\"\\c\n";
+  socket.write_latency.counts.assign(nvlog::LatencyHistogram::kBuckets, 0);
+  socket.write_latency.counts[nvlog::LatencyHistogram::BucketIndex(300)] = 2;
+  socket.write_latency.count = 2;
+  socket.write_latency.sum = 600;
+  stats.sinks.push_back(socket);
+
+  std::string text = stats.ToText();
+  REQUIRE(text.find("nvlog_enqueued_total 8000\n") != std::string::npos);
+  REQUIRE(text.find("nvlog_sink_processed_total{sink=\"0\",name=\"console\"} "
+                    "42\n") != std::string::npos);
+  REQUIRE(text.find("nvlog_log_latency_ns_sum 0\n") != std::string::npos);
+  REQUIRE(text.find("nvlog_log_latency_ns_count 0\n") != std::string::npos);
+  std::string labels = "{sink=\"1\",name=\"unix:/tmp/a \\\"b\\\"\\\\c\\n\"}";
+  REQUIRE(text.find("nvlog_sink_processed_total" + labels + " 0\n") !=
+          std::string::npos);
+  REQUIRE(text.find("nvlog_sink_write_latency_ns_sum" + labels + " 600\n") !=
+          std::string::npos);
+  REQUIRE(text.find("nvlog_sink_write_latency_ns_count" + labels + " 2\n") !=
+          std::string::npos);
+}
@@ -0,0 +1,251 @@
+#include "nvlog/priority_lanes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "nvlog/logger.h"
+
+// Explanation
+// # Strict:
+//
+// An error enqueued after a backlog of debug records is dequeued first,
+// the end marker last.
+//
+// # Barrier:
+//
+// Under weighted drain and producer shards, a null marker comes out once,
+// after every record queued before it in any lane or shard.
+//
+// # Weighted:
+//
+// Lanes are served in proportion of their weights while all are full,
+// the low lane is never starved.
+//
+// # PerProducer:
+//
+// Producers sharing a sharded lane keep their own order.
+//
+// # Logger:
+//
+// With lanes in the channel and the sink, an error logged while the sink
+// is stuck behind a debug backlog is written right after the stuck record.
+// Under weighted lanes ```Sync()``` returns once every record logged
+// before it is written.
+
+namespace {
+
+nvlog::LogMessagePtr Make(nvlog::LogLevel level, int value) {
+  return nvlog::MakeLogMessage(std::chrono::system_clock::now(), level,
+                               "LANE", std::to_string(value), __FILE__,
+                               __LINE__, "1");
+}
+
+class GateSink : public nvlog::AsyncSink {
+ public:
+  void Open() {
+    open_.store(true);
+  }
+
+  const std::vector<nvlog::LogLevel>& Levels() const {
+    return levels_;
+  }
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    while (!open_.load()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    levels_.push_back(log_message->log_level);
+  }
+
+ private:
+  std::atomic<bool> open_{false};
+  std::vector<nvlog::LogLevel> levels_;  // read after shutdown
+};
+
+}  // namespace
+
+TEST_CASE("PriorityLanes Test") {
+  SECTION("Strict") {
+    nvlog::PriorityLanes lanes;
+    lanes.Configure(nvlog::LaneOptions());
+    for (int i = 0; i < 100; ++i) {
+      lanes.Enqueue(Make(nvlog::LogLevel::Debug, i));
+    }
+    lanes.Enqueue(nullptr);
+    lanes.Enqueue(Make(nvlog::LogLevel::Info, 0));
+    lanes.Enqueue(Make(nvlog::LogLevel::Error, 0));
+    // The marker is queued in each of the three lanes
+    REQUIRE(lanes.Size() == 105);
+
+    nvlog::LogMessagePtr log_message;
+    REQUIRE(lanes.TryDequeue(log_message));
+    REQUIRE(log_message->log_level == nvlog::LogLevel::Error);
+    REQUIRE(lanes.TryDequeue(log_message));
+    REQUIRE(log_message->log_level == nvlog::LogLevel::Info);
+    for (int i = 0; i < 100; ++i) {
+      REQUIRE(lanes.TryDequeue(log_message));
+      REQUIRE(log_message->message == std::to_string(i));
+    }
+    REQUIRE(lanes.TryDequeue(log_message));
+    REQUIRE_FALSE(log_message);
+    REQUIRE_FALSE(lanes.TryDequeue(log_message));
+  }
+
+  SECTION("Weighted") {
+    nvlog::LaneOptions options;
+    options.drain = nvlog::LaneDrain::Weighted;
+    options.weights[0] = 4;
+    options.weights[1] = 2;
+    options.weights[2] = 1;
+    nvlog::PriorityLanes lanes;
+    lanes.Configure(options);
+    for (int i = 0; i < 70; ++i) {
+      lanes.Enqueue(Make(nvlog::LogLevel::Trace, i));
+      lanes.Enqueue(Make(nvlog::LogLevel::Info, i));
+      lanes.Enqueue(Make(nvlog::LogLevel::Fatal, i));
+    }
+
+    int counts[3] = {0, 0, 0};
+    nvlog::LogMessagePtr log_message;
+    for (int i = 0; i < 70; ++i) {
+      REQUIRE(lanes.TryDequeue(log_message));
+      if (log_message->log_level == nvlog::LogLevel::Fatal) {
+        ++counts[0];
+      } else if (log_message->log_level == nvlog::LogLevel::Info) {
+        ++counts[1];
+      } else {
+        ++counts[2];
+      }
+    }
+    REQUIRE(counts[0] == 40);
+    REQUIRE(counts[1] == 20);
+    REQUIRE(counts[2] == 10);
+  }
+
+  SECTION("Barrier") {
+    nvlog::LaneOptions options;
+    options.drain = nvlog::LaneDrain::Weighted;
+    options.order = nvlog::LaneOrder::PerProducer;
+    nvlog::PriorityLanes lanes;
+    lanes.Configure(options);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < 4; ++p) {
+      threads.emplace_back([&lanes]() {
+        for (int i = 0; i < 100; ++i) {
+          lanes.Enqueue(Make(nvlog::LogLevel::Debug, i));
+          lanes.Enqueue(Make(nvlog::LogLevel::Info, i));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    lanes.Enqueue(nullptr);
+    for (int i = 0; i < 100; ++i) {
+      lanes.Enqueue(Make(nvlog::LogLevel::Error, i));
+    }
+
+    int before = 0;
+    int markers = 0;
+    nvlog::LogMessagePtr log_message;
+    while (lanes.TryDequeue(log_message)) {
+      if (!log_message) {
+        ++markers;
+        REQUIRE(before == 800);
+      } else if (log_message->log_level != nvlog::LogLevel::Error) {
+        ++before;
+      }
+    }
+    REQUIRE(markers == 1);
+    REQUIRE(lanes.Empty());
+  }
+
+  SECTION("PerProducer") {
+    nvlog::LaneOptions options;
+    options.order = nvlog::LaneOrder::PerProducer;
+    nvlog::PriorityLanes lanes;
+    lanes.Configure(options);
+    const int producers = 4;
+    const int items = 2000;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+      threads.emplace_back([&lanes, p]() {
+        for (int i = 0; i < items; ++i) {
+          lanes.Enqueue(Make(nvlog::LogLevel::Debug, p * items + i));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    std::vector<int> last(producers, -1);
+    bool ordered = true;
+    int received = 0;
+    nvlog::LogMessagePtr log_message;
+    while (lanes.TryDequeue(log_message)) {
+      int value = std::stoi(log_message->message);
+      int producer = value / items;
+      ordered = ordered && value % items > last[producer];
+      last[producer] = value % items;
+      ++received;
+    }
+    REQUIRE(ordered);
+    REQUIRE(received == producers * items);
+  }
+
+  SECTION("Logger") {
+    auto sink = std::make_shared<GateSink>();
+    sink->SetPriorityLanes(nvlog::LaneOptions());
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.SetPriorityLanes();
+    logger.StartEngine();
+
+    for (int i = 0; i < 1000; ++i) {
+      logger.Log(nvlog::LogLevel::Debug, "flood", "LANE", __FILE__, __LINE__);
+    }
+    logger.Log(nvlog::LogLevel::Error, "error", "LANE", __FILE__, __LINE__);
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    // Everything but the stuck record waits in the sink queue
+    while (sink->QueueDepth() != 1000 &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    sink->Open();
+    logger.ShutdownEngine();
+
+    const auto& levels = sink->Levels();
+    REQUIRE(levels.size() == 1001);
+    auto error = std::find(levels.begin(), levels.end(),
+                           nvlog::LogLevel::Error);
+    REQUIRE(error - levels.begin() <= 1);
+  }
+
+  SECTION("Logger sync") {
+    nvlog::LaneOptions options;
+    options.drain = nvlog::LaneDrain::Weighted;
+    auto sink = std::make_shared<GateSink>();
+    sink->SetPriorityLanes(options);
+    sink->Open();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.SetPriorityLanes(options);
+    logger.StartEngine();
+
+    for (int i = 0; i < 1000; ++i) {
+      logger.Log(nvlog::LogLevel::Error, "error", "LANE", __FILE__, __LINE__);
+    }
+    REQUIRE(logger.Sync());
+    REQUIRE(sink->Levels().size() == 1000);
+    logger.ShutdownEngine();
+  }
+}
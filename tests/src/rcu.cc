@@ -0,0 +1,198 @@
+#include "nvlog/rcu.h"
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <thread>
+#include <vector>
+
+#include "nvlog/logger.h"
+#include "nvlog/sink.h"
+
+// Explanation
+// # RcuPtr:
+//
+// Readers check an invariant of the object they loaded while a writer
+// replaces it in a loop; a freed object would break the invariant.
+// Retiring from inside a read section is deferred to the next grace
+// period instead of waiting for itself.
+//
+// # Live reconfiguration:
+//
+// Sinks are added and removed, formatters, levels and tag filters are
+// changed while producers keep logging. A removed sink receives nothing
+// after ```RemoveSink``` returns; an asynchronous sink added to a logger
+// with only synchronous sinks starts the channel worker.
+
+namespace {
+
+struct Pair {
+  int a;
+  int b;
+  Pair(int value) : a(value), b(value) {}
+  ~Pair() {
+    a = -1;
+  }
+};
+
+class CountSink : public nvlog::AsyncSink {
+ public:
+  size_t Count() const {
+    return count_.load();
+  }
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    std::string scratch;
+    Render(*log_message, scratch);
+    count_.fetch_add(1);
+  }
+
+ private:
+  std::atomic<size_t> count_{0};
+};
+
+class CountSyncSink : public nvlog::SyncSink {
+ public:
+  size_t Count() const {
+    return count_.load();
+  }
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& /*log_message*/) override {
+    count_.fetch_add(1);
+  }
+
+ private:
+  std::atomic<size_t> count_{0};
+};
+
+void TagFormatter(std::ostringstream& ss,
+                  const nvlog::LogMessage& log_message) {
+  ss << log_message.tag << ' ' << log_message.message;
+}
+
+}  // namespace
+
+TEST_CASE("Rcu Test") {
+  SECTION("RcuPtr") {
+    nvlog::RcuPtr<Pair> pair(std::make_unique<Pair>(0));
+    std::atomic<bool> stop(false);
+    std::atomic<int> broken(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+      readers.emplace_back([&pair, &stop, &broken]() {
+        while (!stop.load()) {
+          nvlog::RcuReadGuard guard;
+          const Pair* p = pair.Load();
+          int a = p->a;
+          std::this_thread::yield();
+          if (a < 0 || p->b != a) {
+            broken.fetch_add(1);
+          }
+        }
+      });
+    }
+    for (int i = 1; i <= 2000; ++i) {
+      if (i % 2 == 0) {
+        pair.Store(std::make_unique<Pair>(i));
+      } else {
+        pair.Update([i](Pair& next) {
+          next.a = i;
+          next.b = i;
+        });
+      }
+    }
+    stop.store(true);
+    for (auto& reader : readers) {
+      reader.join();
+    }
+    REQUIRE(broken.load() == 0);
+    REQUIRE(pair.Load()->a == 2000);
+  }
+
+  SECTION("Retire inside read section") {
+    auto& domain = nvlog::RcuDomain::Instance();
+    bool freed = false;
+    {
+      nvlog::RcuReadGuard guard;
+      domain.Retire([&freed]() { freed = true; });
+      REQUIRE_FALSE(freed);
+    }
+    domain.Synchronize();
+    REQUIRE(freed);
+  }
+
+  SECTION("Live reconfiguration") {
+    auto first = std::make_shared<CountSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {first};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.StartEngine();
+
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> logged(0);
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 4; ++i) {
+      producers.emplace_back([&logger, &stop, &logged]() {
+        while (!stop.load()) {
+          logger.Log(nvlog::LogLevel::Info, "record", "RCU", __FILE__,
+                     __LINE__);
+          // Paced, so the removed sinks don't have a backlog to drain
+          if (logged.fetch_add(1) % 64 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+          }
+        }
+      });
+    }
+
+    auto second = std::make_shared<CountSink>();
+    auto sync = std::make_shared<CountSyncSink>();
+    for (int round = 0; round < 20; ++round) {
+      logger.AddSink(second);
+      logger.AddSink(sync);
+      second->SetFormatter(TagFormatter);
+      second->SetLevel(nvlog::LogLevel::Debug);
+      second->AllowTags({"RCU"});
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      second->SetFormatter(nvlog::SimpleFormatter);
+      second->DenyTags({"OTHER"});
+      REQUIRE(logger.RemoveSink(sync));
+      REQUIRE(logger.RemoveSink(second));
+    }
+    REQUIRE_FALSE(logger.RemoveSink(second));
+
+    REQUIRE(logger.RemoveSink(first));
+    size_t removed_count = first->Count();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    stop.store(true);
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    logger.ShutdownEngine();
+
+    REQUIRE(first->Count() == removed_count);
+    REQUIRE(removed_count > 0);
+    REQUIRE(second->Count() > 0);
+    REQUIRE(sync->Count() > 0);
+    REQUIRE(logged.load() > removed_count);
+  }
+
+  SECTION("Async sink added to a synchronous logger") {
+    auto sync = std::make_shared<CountSyncSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sync};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.StartEngine();
+    logger.Log(nvlog::LogLevel::Info, "before", "RCU", __FILE__, __LINE__);
+
+    auto async = std::make_shared<CountSink>();
+    logger.AddSink(async);
+    for (int i = 0; i < 100; ++i) {
+      logger.Log(nvlog::LogLevel::Info, "after", "RCU", __FILE__, __LINE__);
+    }
+    logger.ShutdownEngine();
+
+    REQUIRE(sync->Count() == 101);
+    REQUIRE(async->Count() == 100);
+  }
+}
@@ -0,0 +1,230 @@
+#include "nvlog/shm_ring.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Explanation
+// # Publish and consume:
+//
+// Several threads, each attached like a separate process, publish while
+// one consumer drains the ring; every record arrives once, in order per
+// producer. ```ShmRingSink``` publishes the records of a logger.
+//
+// # Crashed publisher:
+//
+// A forked child claims a slot and exits before publishing it. The
+// consumer sees the pid is gone, skips the slot and delivers the records
+// published after it. Slots back to Free carry no publisher pid.
+//
+// # Stuck claim / Full ring / Corrupted slot:
+//
+// A claimed slot never written is skipped after the abandon timeout, a
+// full ring refuses records, a slot failing its checksum is not delivered.
+
+namespace {
+
+std::string RingName(const std::string& name) {
+  return "/nvlog_test_" + std::to_string(::getpid()) + "_" + name;
+}
+
+nvlog::LogMessagePtr MakeMessage(const std::string& message) {
+  return nvlog::MakeLogMessage(std::chrono::system_clock::now(),
+                               nvlog::LogLevel::Info, "SHM", message, __FILE__,
+                               __LINE__, nvlog::GetThreadId());
+}
+
+std::vector<std::string> ConsumeAll(nvlog::ShmRing& ring) {
+  std::vector<std::string> messages;
+  ring.Consume([&messages](nvlog::LogMessagePtr log_message) {
+    messages.push_back(log_message->message);
+  });
+  return messages;
+}
+
+std::unique_ptr<nvlog::ShmRing> CreateRing(const std::string& name,
+                                           size_t slots) {
+  nvlog::ShmRing::Unlink(name);
+  nvlog::ShmRingOptions options;
+  options.slots = slots;
+  return nvlog::ShmRing::Create(name, options);
+}
+
+}  // namespace
+
+TEST_CASE("ShmRing Test") {
+  SECTION("Publish and consume") {
+    std::string name = RingName("mpsc");
+    auto ring = CreateRing(name, 256);
+    REQUIRE(ring);
+
+    const int producers = 4;
+    const int records = 2000;
+    std::atomic<int> done(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+      threads.emplace_back([&name, &done, p]() {
+        auto publisher = nvlog::ShmRing::Open(name);
+        for (int i = 0; i < records; ++i) {
+          auto log_message = MakeMessage(std::to_string(p) + ":" +
+                                         std::to_string(i));
+          while (!publisher->Publish(*log_message)) {
+            std::this_thread::yield();
+          }
+        }
+        done.fetch_add(1);
+      });
+    }
+
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    bool ordered = true;
+    auto check = [&](nvlog::LogMessagePtr log_message) {
+      const std::string& message = log_message->message;
+      size_t colon = message.find(':');
+      int p = std::stoi(message.substr(0, colon));
+      int i = std::stoi(message.substr(colon + 1));
+      ordered = ordered && next[p] == i;
+      next[p] = i + 1;
+      ++received;
+    };
+    while (done.load() < producers || received < producers * records) {
+      if (ring->Consume(check) == 0) {
+        ring->Wait(std::chrono::milliseconds(10));
+      }
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    REQUIRE(received == producers * records);
+    REQUIRE(ordered);
+    REQUIRE(ring->Abandoned() == 0);
+    REQUIRE(ring->Corrupted() == 0);
+    nvlog::ShmRing::Unlink(name);
+  }
+
+  SECTION("ShmRingSink") {
+    std::string name = RingName("sink");
+    nvlog::ShmRing::Unlink(name);
+    auto sink = std::make_shared<nvlog::ShmRingSink>(name);
+    REQUIRE_FALSE(sink->IsRun());
+    sink->Log(MakeMessage("lost"));
+    REQUIRE(sink->Dropped() == 1);
+
+    auto ring = CreateRing(name, 16);
+    REQUIRE(ring);
+    sink = std::make_shared<nvlog::ShmRingSink>(name);
+    REQUIRE(sink->IsRun());
+    sink->Log(MakeMessage("kept"));
+
+    std::vector<std::string> messages;
+    std::string thread_id;
+    ring->Consume([&](nvlog::LogMessagePtr log_message) {
+      messages.push_back(log_message->message);
+      thread_id = log_message->thread_id;
+    });
+    REQUIRE(messages == std::vector<std::string>{"kept"});
+    REQUIRE(thread_id == std::to_string(::getpid()) + "/" +
+                             nvlog::GetThreadId());
+    REQUIRE(sink->Stats().processed == 1);
+    nvlog::ShmRing::Unlink(name);
+  }
+
+  SECTION("Crashed publisher") {
+    std::string name = RingName("crash");
+    auto ring = CreateRing(name, 16);
+    REQUIRE(ring);
+
+    pid_t child = ::fork();
+    if (child == 0) {
+      // Claim a slot, start writing it and die
+      auto publisher = nvlog::ShmRing::Open(name);
+      uint64_t position = publisher->Header()->head.fetch_add(1);
+      nvlog::ShmSlot* slot = publisher->SlotAt(position);
+      slot->state.store(position * 4 + nvlog::kShmSlotWriting);
+      slot->pid.store(::getpid());
+      ::_exit(0);
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+
+    auto publisher = nvlog::ShmRing::Open(name);
+    REQUIRE(publisher->Publish(*MakeMessage("after")));
+
+    std::vector<std::string> messages = ConsumeAll(*ring);
+    REQUIRE(messages == std::vector<std::string>{"after"});
+    REQUIRE(ring->Abandoned() == 1);
+    // Both slots are Free again, without a stale publisher pid
+    REQUIRE(ring->SlotAt(0)->pid.load() == 0);
+    REQUIRE(ring->SlotAt(1)->pid.load() == 0);
+    nvlog::ShmRing::Unlink(name);
+  }
+
+  SECTION("Stuck claim") {
+    std::string name = RingName("stuck");
+    auto ring = CreateRing(name, 16);
+    REQUIRE(ring);
+    ring->SetAbandonTimeout(std::chrono::milliseconds(10));
+
+    ring->Header()->head.fetch_add(1);
+    REQUIRE(ring->Publish(*MakeMessage("after")));
+    REQUIRE(ConsumeAll(*ring).empty());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(ConsumeAll(*ring) == std::vector<std::string>{"after"});
+    REQUIRE(ring->Abandoned() == 1);
+    nvlog::ShmRing::Unlink(name);
+  }
+
+  SECTION("Full ring") {
+    std::string name = RingName("full");
+    auto ring = CreateRing(name, 4);
+    REQUIRE(ring);
+
+    for (int i = 0; i < 4; ++i) {
+      REQUIRE(ring->Publish(*MakeMessage(std::to_string(i))));
+    }
+    REQUIRE_FALSE(ring->Publish(*MakeMessage("4")));
+    REQUIRE(ring->Full() == 1);
+
+    REQUIRE(ConsumeAll(*ring).size() == 4);
+    REQUIRE(ring->Publish(*MakeMessage("5")));
+    REQUIRE(ConsumeAll(*ring) == std::vector<std::string>{"5"});
+    nvlog::ShmRing::Unlink(name);
+  }
+
+  SECTION("Corrupted slot") {
+    std::string name = RingName("corrupt");
+    auto ring = CreateRing(name, 4);
+    REQUIRE(ring);
+
+    REQUIRE(ring->Publish(*MakeMessage("first")));
+    REQUIRE(ring->Publish(*MakeMessage("second")));
+    char* data = reinterpret_cast<char*>(ring->SlotAt(0) + 1);
+    data[sizeof(nvlog::RecordHeader)] ^= 0x55;
+
+    REQUIRE(ConsumeAll(*ring) == std::vector<std::string>{"second"});
+    REQUIRE(ring->Corrupted() == 1);
+    nvlog::ShmRing::Unlink(name);
+  }
+
+  SECTION("Long message") {
+    std::string name = RingName("long");
+    auto ring = CreateRing(name, 4);
+    REQUIRE(ring);
+
+    std::string message(4096, 'x');
+    REQUIRE(ring->Publish(*MakeMessage(message)));
+    std::vector<std::string> messages = ConsumeAll(*ring);
+    REQUIRE(messages.size() == 1);
+    REQUIRE(messages[0].size() < message.size());
+    REQUIRE(message.compare(0, messages[0].size(), messages[0]) == 0);
+    nvlog::ShmRing::Unlink(name);
+  }
+}
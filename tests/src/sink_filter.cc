@@ -0,0 +1,165 @@
+#include "nvlog/sink_filter.h"
+
+#include <catch2/catch_all.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvlog/channel.h"
+#include "nvlog/sink.h"
+
+// Explanation
+// # Filter compilation:
+//
+// Level threshold is compiled into a level mask and tags into a bitmask of
+// interned tag IDs, both are checked without touching the tag string.
+//
+// # Channel dispatch:
+//
+// Channel only hands a message to the sinks whose filter accepts it,
+// a capturing sink records what it actually received. A tag never
+// interned is in no set, kept by a deny filter and not added to the
+// registry.
+//
+// # Shared render:
+//
+// Sinks sharing a formatter receive the text rendered once by the channel.
+
+namespace {
+
+class CaptureSink : public nvlog::Sink {
+ public:
+  void Log(nvlog::LogMessagePtr log_message) override {
+    std::lock_guard<std::mutex> lock(mu_);
+    messages_.push_back(log_message->message);
+    rendered_ = log_message->FindRendered(GetFormatter()) != nullptr;
+  }
+  void Start() override {}
+  void Shutdown(bool /*force*/ = false) override {}
+  bool IsRun() const override {
+    return true;
+  }
+
+  std::vector<std::string> Messages() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return messages_;
+  }
+
+  bool LastRendered() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return rendered_;
+  }
+
+ private:
+  mutable std::mutex mu_;
+  std::vector<std::string> messages_;
+  bool rendered_ = false;
+};
+
+void WaitFor(const CaptureSink& sink, size_t count) {
+  for (int i = 0; i < 200 && sink.Messages().size() < count; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+nvlog::LogMessagePtr MakeMessage(nvlog::LogLevel level, const std::string& tag,
+                                 const std::string& msg) {
+  return nvlog::MakeLogMessage(std::chrono::system_clock::now(), level, tag,
+                               msg, __FILE__, __LINE__, nvlog::GetThreadId());
+}
+
+}  // namespace
+
+TEST_CASE("SinkFilter Test") {
+  nvlog::SinkFilter filter;
+
+  SECTION("Default accepts everything") {
+    REQUIRE(filter.AcceptsLevel(nvlog::LogLevel::Trace));
+    REQUIRE(filter.AcceptsLevel(nvlog::LogLevel::Fatal));
+    REQUIRE_FALSE(filter.HasTagFilter());
+  }
+
+  SECTION("Level threshold") {
+    filter.SetLevel(nvlog::LogLevel::Warning);
+    REQUIRE_FALSE(filter.AcceptsLevel(nvlog::LogLevel::Debug));
+    REQUIRE_FALSE(filter.AcceptsLevel(nvlog::LogLevel::Info));
+    REQUIRE(filter.AcceptsLevel(nvlog::LogLevel::Warning));
+    REQUIRE(filter.AcceptsLevel(nvlog::LogLevel::Fatal));
+  }
+
+  SECTION("Allow and deny tags") {
+    auto& registry = nvlog::TagRegistry::Instance();
+    uint32_t db = registry.Intern("DB");
+    uint32_t http = registry.Intern("HTTP");
+
+    filter.SetTagFilter(
+        nvlog::TagFilter(nvlog::TagFilterMode::Allow, {"DB"}));
+    REQUIRE(filter.AcceptsTag(db));
+    REQUIRE_FALSE(filter.AcceptsTag(http));
+    REQUIRE_FALSE(filter.AcceptsTag(nvlog::kUnresolvedTagId));
+
+    filter.SetTagFilter(
+        nvlog::TagFilter(nvlog::TagFilterMode::Deny, {"DB"}));
+    REQUIRE_FALSE(filter.AcceptsTag(db));
+    REQUIRE(filter.AcceptsTag(http));
+    REQUIRE(filter.AcceptsTag(nvlog::kUnresolvedTagId));
+
+    // Past the small string buffer, still found by its text
+    std::string long_tag = "A-TAG-LONGER-THAN-SSO";
+    uint32_t id = registry.Intern(long_tag);
+    REQUIRE(registry.Intern(std::string(long_tag)) == id);
+    REQUIRE(registry.Find(long_tag) == id);
+    REQUIRE(registry.NameView(id) == long_tag);
+  }
+}
+
+TEST_CASE("Channel per-sink filter Test") {
+  auto errors = std::make_shared<CaptureSink>();
+  errors->SetLevel(nvlog::LogLevel::Error);
+  auto db = std::make_shared<CaptureSink>();
+  db->AllowTags({"DB"});
+  auto no_db = std::make_shared<CaptureSink>();
+  no_db->DenyTags({"DB"});
+
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks = {errors, db, no_db};
+  nvlog::Channel channel(nullptr, sinks);
+  channel.Start();
+  size_t registry_size = nvlog::TagRegistry::Instance().Size();
+
+  channel.Enqueue(MakeMessage(nvlog::LogLevel::Trace, "DB", "trace-db"));
+  channel.Enqueue(MakeMessage(nvlog::LogLevel::Error, "HTTP", "error-http"));
+  channel.Enqueue(MakeMessage(nvlog::LogLevel::Info, "HTTP", "info-http"));
+  channel.Enqueue(
+      MakeMessage(nvlog::LogLevel::Info, "NEVER-INTERNED", "info-new"));
+
+  WaitFor(*errors, 1);
+  WaitFor(*db, 1);
+  WaitFor(*no_db, 3);
+  channel.Shutdown(false);
+
+  REQUIRE(errors->Messages() == std::vector<std::string>{"error-http"});
+  REQUIRE(db->Messages() == std::vector<std::string>{"trace-db"});
+  REQUIRE(no_db->Messages() ==
+          std::vector<std::string>{"error-http", "info-http", "info-new"});
+  // Tags unknown to the registry are looked up, not interned
+  REQUIRE(nvlog::TagRegistry::Instance().Size() == registry_size);
+}
+
+TEST_CASE("Channel shared render Test") {
+  auto first = std::make_shared<CaptureSink>();
+  auto second = std::make_shared<CaptureSink>();
+  auto simple = std::make_shared<CaptureSink>();
+  simple->SetFormatter(nvlog::SimpleFormatter);
+
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks = {first, second, simple};
+  nvlog::Channel channel(nullptr, sinks);
+  channel.Start();
+  channel.Enqueue(MakeMessage(nvlog::LogLevel::Info, "", "shared"));
+  WaitFor(*simple, 1);
+  channel.Shutdown(false);
+
+  REQUIRE(first->LastRendered());
+  REQUIRE(second->LastRendered());
+  REQUIRE_FALSE(simple->LastRendered());
+}
@@ -0,0 +1,190 @@
+#include <catch2/catch_all.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nvlog/logger.h"
+#include "nvlog/sink.h"
+
+// Explanation
+// # Inline write:
+//
+// A synchronous sink has the record when ```Log``` returns, written on the
+// producer thread, and a logger with only synchronous sinks starts no
+// channel worker.
+//
+// # Mixed sinks:
+//
+// Synchronous and asynchronous sinks on the same logger both receive every
+// record, each with its own filter; backtrace mode still applies.
+//
+// # Sink logging:
+//
+// A synchronous sink logging from its ```Process```, with backtrace mode
+// on, neither recurses nor deadlocks: its record is written once the
+// outer one is.
+
+namespace {
+
+class RecordSyncSink : public nvlog::SyncSink {
+ public:
+  size_t Count() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return messages_.size();
+  }
+  std::vector<std::string> Messages() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return messages_;
+  }
+  std::thread::id LastThread() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return last_thread_;
+  }
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    std::lock_guard<std::mutex> lock(mu_);
+    messages_.push_back(log_message->message);
+    last_thread_ = std::this_thread::get_id();
+  }
+
+ private:
+  mutable std::mutex mu_;
+  std::vector<std::string> messages_;
+  std::thread::id last_thread_;
+};
+
+class RecordAsyncSink : public nvlog::AsyncSink {
+ public:
+  size_t Count() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return count_;
+  }
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& /*log_message*/) override {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++count_;
+  }
+
+ private:
+  mutable std::mutex mu_;
+  size_t count_ = 0;
+};
+
+// Logs a record of its own for every error it writes
+class EchoSyncSink : public RecordSyncSink {
+ public:
+  nvlog::Logger* logger = nullptr;
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    RecordSyncSink::Process(log_message);
+    if (log_message->log_level == nvlog::LogLevel::Error) {
+      logger->Log(nvlog::LogLevel::Info, "echo " + log_message->message,
+                  "TEST", __FILE__, __LINE__);
+    }
+  }
+};
+
+void Emit(nvlog::Logger& logger, nvlog::LogLevel level,
+          const std::string& message) {
+  logger.Log(level, message, "TEST", __FILE__, __LINE__);
+}
+
+}  // namespace
+
+TEST_CASE("SyncSink Test") {
+  SECTION("Inline write") {
+    auto sink = std::make_shared<RecordSyncSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.StartEngine();
+
+    for (int i = 0; i < 100; ++i) {
+      Emit(logger, nvlog::LogLevel::Info, std::to_string(i));
+      REQUIRE(sink->Count() == static_cast<size_t>(i + 1));
+    }
+    REQUIRE(sink->LastThread() == std::this_thread::get_id());
+    logger.ShutdownEngine();
+    REQUIRE_FALSE(sink->IsRun());
+  }
+
+  SECTION("Concurrent producers") {
+    auto sink = std::make_shared<RecordSyncSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.StartEngine();
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+      producers.emplace_back([&logger]() {
+        for (int i = 0; i < 1000; ++i) {
+          Emit(logger, nvlog::LogLevel::Info, "m");
+        }
+      });
+    }
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    REQUIRE(sink->Count() == 4000);
+    logger.ShutdownEngine();
+  }
+
+  SECTION("Mixed sinks") {
+    auto sync_sink = std::make_shared<RecordSyncSink>();
+    auto async_sink = std::make_shared<RecordAsyncSink>();
+    sync_sink->SetLevel(nvlog::LogLevel::Warning);
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sync_sink, async_sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.StartEngine();
+
+    for (int i = 0; i < 500; ++i) {
+      Emit(logger, i % 2 ? nvlog::LogLevel::Info : nvlog::LogLevel::Error,
+           std::to_string(i));
+    }
+    REQUIRE(sync_sink->Count() == 250);
+    logger.ShutdownEngine();
+    REQUIRE(async_sink->Count() == 500);
+  }
+
+  SECTION("Backtrace") {
+    auto sink = std::make_shared<RecordSyncSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    logger.EnableBacktrace(nvlog::BacktraceOptions());
+    logger.StartEngine();
+
+    Emit(logger, nvlog::LogLevel::Debug, "context");
+    Emit(logger, nvlog::LogLevel::Info, "info");
+    REQUIRE(sink->Messages() == std::vector<std::string>{"info"});
+    Emit(logger, nvlog::LogLevel::Error, "error");
+    REQUIRE(sink->Messages() ==
+            std::vector<std::string>{"info", "context", "error"});
+    logger.ShutdownEngine();
+  }
+
+  SECTION("Sink logging") {
+    auto sink = std::make_shared<EchoSyncSink>();
+    auto async_sink = std::make_shared<RecordAsyncSink>();
+    std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink, async_sink};
+    nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                         sinks);
+    sink->logger = &logger;
+    logger.EnableBacktrace(nvlog::BacktraceOptions());
+    logger.StartEngine();
+
+    Emit(logger, nvlog::LogLevel::Debug, "context");
+    Emit(logger, nvlog::LogLevel::Error, "a");
+    Emit(logger, nvlog::LogLevel::Error, "b");
+    REQUIRE(sink->Messages() == std::vector<std::string>{"context", "a",
+                                                         "echo a", "b",
+                                                         "echo b"});
+    logger.ShutdownEngine();
+    REQUIRE(async_sink->Count() == 5);
+  }
+}
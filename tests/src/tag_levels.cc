@@ -0,0 +1,116 @@
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <string>
+#include <vector>
+
+#include "nvlog/logger.h"
+#include "nvlog/tag_registry.h"
+
+// Explanation
+// # Per-tag levels:
+//
+// With the logger at Info, ```DB``` set to Debug and ```HTTP``` to Warning,
+// each tag follows its own level and the other tags the logger level,
+// until the tag level is cleared.
+//
+// # Call site cache:
+//
+// The literal tag of a site is interned on the first call only. A runtime
+// tag is looked up, never interned, so unknown tags do not grow the
+// registry; once it has an ID the record views it in the registry instead
+// of copying it.
+
+namespace {
+
+class KeepSink : public nvlog::SyncSink {
+ public:
+  std::vector<nvlog::LogMessagePtr> records;
+
+ protected:
+  void Process(const nvlog::LogMessagePtr& log_message) override {
+    records.push_back(log_message);
+  }
+};
+
+}  // namespace
+
+TEST_CASE("TagLevels Test") {
+  auto sink = std::make_shared<KeepSink>();
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks = {sink};
+  nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                       sinks);
+  logger.StartEngine();
+  logger.SetLevel(nvlog::LogLevel::Info);
+
+  SECTION("Per-tag levels") {
+    REQUIRE(logger.SetTagLevel("DB", nvlog::LogLevel::Debug));
+    REQUIRE(logger.SetTagLevel("HTTP", nvlog::LogLevel::Warning));
+
+    NVLOG_SITE(nvlog::LogLevel::Debug, "");
+    logger.Log(nvlog_site, "db debug", "DB");
+    logger.Log(nvlog_site, "other debug", "OTHER");
+    logger.Log(nvlog_site, "untagged debug");
+    logger.Log(nvlog::LogLevel::Info, "http info", "HTTP", __FILE__,
+               __LINE__);
+    logger.Log(nvlog::LogLevel::Warning, "http warning", "HTTP", __FILE__,
+               __LINE__);
+    logger.Log(nvlog::LogLevel::Info, "other info", "OTHER", __FILE__,
+               __LINE__);
+
+    logger.ClearTagLevel("DB");
+    logger.Log(nvlog_site, "db debug cleared", "DB");
+
+    REQUIRE(sink->records.size() == 3);
+    REQUIRE(sink->records[0]->message == "db debug");
+    REQUIRE(sink->records[1]->message == "http warning");
+    REQUIRE(sink->records[2]->message == "other info");
+    logger.ClearTagLevel("HTTP");
+  }
+
+  SECTION("Call site cache") {
+    auto& registry = nvlog::TagRegistry::Instance();
+    std::atomic<uint32_t> cache(nvlog::kUnresolvedTagId);
+    uint32_t id = nvlog::ResolveTag(cache, "CACHED");
+    REQUIRE(id != nvlog::kUnresolvedTagId);
+    REQUIRE(cache.load() == id);
+    REQUIRE(registry.Name(id) == "CACHED");
+    REQUIRE(nvlog::ResolveTag(cache, "CACHED") == id);
+
+    NVLOG_SITE(nvlog::LogLevel::Info, "SITE");
+    std::atomic<uint32_t> site_cache(nvlog::kUnresolvedTagId);
+    uint32_t site_id = logger.TagId(site_cache, nvlog_site);
+    REQUIRE(registry.Name(site_id) == "SITE");
+    REQUIRE(site_cache.load() == site_id);
+
+    // Runtime tags are only looked up while a tag has its own level, and
+    // never interned: a tag without a level inherits
+    REQUIRE(logger.TagId(std::string("RUNTIME")) == nvlog::kUnresolvedTagId);
+    logger.SetTagLevel("ANY", nvlog::LogLevel::Error);
+    size_t size = registry.Size();
+    REQUIRE(logger.TagId(std::string("RUNTIME")) == nvlog::kUnresolvedTagId);
+    REQUIRE(registry.Find("RUNTIME") == nvlog::kUnresolvedTagId);
+    REQUIRE(registry.Size() == size);
+    logger.SetTagLevel("RUNTIME", nvlog::LogLevel::Info);
+    uint32_t runtime_id = logger.TagId(std::string("RUNTIME"));
+    REQUIRE(runtime_id == registry.Find("RUNTIME"));
+    REQUIRE(runtime_id != nvlog::kUnresolvedTagId);
+
+    logger.LogAdmitted(nvlog_site, "viewed", std::string("RUNTIME"),
+                       runtime_id);
+    logger.LogAdmitted(nvlog_site, "copied", std::string("RUNTIME"));
+    logger.ClearTagLevel("ANY");
+    logger.ClearTagLevel("RUNTIME");
+
+    REQUIRE(sink->records.size() == 2);
+    const auto& viewed = *sink->records[0];
+    REQUIRE(viewed.tag == "RUNTIME");
+    REQUIRE(viewed.tag_id == runtime_id);
+    REQUIRE_FALSE(viewed.storage);
+    REQUIRE(viewed.tag.data() == registry.NameView(runtime_id).data());
+    const auto& copied = *sink->records[1];
+    REQUIRE(copied.tag == "RUNTIME");
+    REQUIRE(copied.storage);
+  }
+
+  logger.ShutdownEngine();
+}
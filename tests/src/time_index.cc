@@ -0,0 +1,284 @@
+#include "nvlog/time_index.h"
+
+#include <unistd.h>
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvlog/binary_file_sink.h"
+#include "nvlog/defered_file_sink.h"
+
+// Explanation
+// # Query:
+//
+// Records with synthetic timestamps are indexed in blocks; a query only
+// returns the blocks overlapping the window with a record at the minimum
+// level or above. Log bytes past the last entry are returned unindexed.
+//
+// # Unindexed:
+//
+// Bytes written before the first entry or after the last one are only
+// returned when the times of the neighbouring entry leave room for the
+// window: the prefix is older than the first entry, the tail newer than
+// the last one.
+//
+// # Reopen:
+//
+// A writer reopening the index of a grown log appends to it, one of a
+// truncated log starts it over.
+//
+// # BinaryFileSink:
+//
+// Records logged through the sink are found again at the offsets the
+// index gives.
+//
+// # Sink restart:
+//
+// Shutting a ```DeferredFileSink``` down ends the block in progress, the
+// index stays open and records logged after the next start are indexed.
+//
+// # Emergency drain:
+//
+// The crash path of a ```DeferredFileSink``` writes the index entry of the
+// buffered records before appending them to the log.
+
+namespace {
+
+constexpr int64_t kSecond = 1000000000;
+
+std::string LogPath(const std::string& name) {
+  return "/tmp/nvlog_test_" + std::to_string(::getpid()) + "_" + name;
+}
+
+void Remove(const std::string& filename) {
+  ::unlink(filename.c_str());
+  ::unlink(nvlog::TimeIndexFilename(filename).c_str());
+}
+
+nvlog::LogMessage MakeMessage(int64_t ns, nvlog::LogLevel level) {
+  return nvlog::LogMessage(
+      std::chrono::system_clock::time_point(
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::nanoseconds(ns))),
+      level, "IDX", "record", __FILE__, __LINE__, "1", nullptr);
+}
+
+// Append ```count``` records of 100 bytes, one second apart from
+// ```first_second```, to the log and its index
+void Append(const std::string& filename, int first_second, int count,
+            nvlog::LogLevel level = nvlog::LogLevel::Info) {
+  std::ofstream file(filename, std::ios::app | std::ios::binary);
+  nvlog::TimeIndexWriter index(filename, nvlog::TimeIndexFormat::Text, 1000);
+  for (int i = 0; i < count; ++i) {
+    file << std::string(99, 'x') << '\n';
+    index.Add(MakeMessage((first_second + i) * kSecond, level), 100);
+  }
+}
+
+std::vector<nvlog::TimeIndexRange> Query(const std::string& filename,
+                                         int64_t from_ns, int64_t to_ns,
+                                         nvlog::LogLevel min_level) {
+  std::vector<nvlog::TimeIndexRange> ranges;
+  nvlog::TimeIndexFormat format;
+  REQUIRE(nvlog::QueryTimeIndex(filename, from_ns, to_ns, min_level, &ranges,
+                                &format));
+  return ranges;
+}
+
+}  // namespace
+
+TEST_CASE("TimeIndex Test") {
+  SECTION("Query") {
+    std::string filename = LogPath("query.log");
+    Remove(filename);
+    Append(filename, 0, 100);
+    // Ten blocks of ten records, one error in the 6th block
+    Append(filename, 100, 1, nvlog::LogLevel::Error);
+
+    auto ranges = Query(filename, 25 * kSecond, 34 * kSecond,
+                        nvlog::LogLevel::Trace);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].offset == 2000);
+    REQUIRE(ranges[0].size == 2000);
+    REQUIRE(ranges[0].indexed);
+
+    ranges = Query(filename, 0, 200 * kSecond, nvlog::LogLevel::Error);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].offset == 10000);
+    REQUIRE(ranges[0].size == 100);
+
+    REQUIRE(Query(filename, 500 * kSecond, 600 * kSecond,
+                  nvlog::LogLevel::Trace)
+                .empty());
+
+    // Not yet indexed
+    std::ofstream(filename, std::ios::app) << std::string(99, 'y') << '\n';
+    ranges = Query(filename, 500 * kSecond, 600 * kSecond,
+                   nvlog::LogLevel::Trace);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].offset == 10100);
+    REQUIRE_FALSE(ranges[0].indexed);
+    Remove(filename);
+  }
+
+  SECTION("Unindexed") {
+    std::string filename = LogPath("unindexed.log");
+    Remove(filename);
+    std::ofstream(filename) << std::string(99, 'p') << '\n';
+    Append(filename, 100, 10);
+    std::ofstream(filename, std::ios::app) << std::string(99, 't') << '\n';
+
+    auto ranges = Query(filename, 0, 50 * kSecond, nvlog::LogLevel::Trace);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].offset == 0);
+    REQUIRE(ranges[0].size == 100);
+    REQUIRE_FALSE(ranges[0].indexed);
+
+    ranges = Query(filename, 200 * kSecond, 300 * kSecond,
+                   nvlog::LogLevel::Trace);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].offset == 1100);
+    REQUIRE_FALSE(ranges[0].indexed);
+
+    // Within the block: records of the prefix and the tail logged out of
+    // order across threads may still fall in the window
+    ranges = Query(filename, 105 * kSecond, 105 * kSecond,
+                   nvlog::LogLevel::Trace);
+    REQUIRE(ranges.size() == 3);
+    REQUIRE_FALSE(ranges[0].indexed);
+    REQUIRE(ranges[1].offset == 100);
+    REQUIRE(ranges[1].indexed);
+    REQUIRE_FALSE(ranges[2].indexed);
+    Remove(filename);
+  }
+
+  SECTION("Reopen") {
+    std::string filename = LogPath("reopen.log");
+    Remove(filename);
+    Append(filename, 0, 10);
+    Append(filename, 10, 10);
+    REQUIRE(Query(filename, 15 * kSecond, 15 * kSecond,
+                  nvlog::LogLevel::Trace)[0]
+                .offset == 1000);
+
+    // Truncated under the index
+    std::ofstream(filename, std::ios::trunc).close();
+    Append(filename, 50, 10);
+    auto ranges = Query(filename, 0, 100 * kSecond, nvlog::LogLevel::Trace);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].offset == 0);
+    REQUIRE(ranges[0].size == 1000);
+    REQUIRE(ranges[0].indexed);
+    Remove(filename);
+  }
+
+  SECTION("BinaryFileSink") {
+    std::string filename = LogPath("sink.bin");
+    Remove(filename);
+    auto sink = std::make_shared<nvlog::BinaryFileSink>(filename);
+    sink->EnableTimeIndex(4096);
+    sink->Start();
+    auto start = std::chrono::system_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+      sink->Log(nvlog::MakeLogMessage(
+          start + std::chrono::seconds(i),
+          i == 700 ? nvlog::LogLevel::Error : nvlog::LogLevel::Info, "IDX",
+          std::to_string(i), __FILE__, __LINE__, nvlog::GetThreadId()));
+    }
+    sink->Shutdown();
+    sink.reset();
+
+    std::vector<nvlog::TimeIndexRange> ranges;
+    nvlog::TimeIndexFormat format;
+    REQUIRE(nvlog::QueryTimeIndex(filename, INT64_MIN, INT64_MAX,
+                                  nvlog::LogLevel::Error, &ranges, &format));
+    REQUIRE(format == nvlog::TimeIndexFormat::Binary);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].indexed);
+
+    std::ifstream file(filename, std::ios::binary);
+    std::string block(ranges[0].size, '\0');
+    file.seekg(static_cast<std::streamoff>(ranges[0].offset));
+    file.read(&block[0], static_cast<std::streamsize>(block.size()));
+
+    bool found = false;
+    for (size_t offset = 0; offset < block.size();) {
+      auto log_message = nvlog::DecodeRecord(block.data() + offset,
+                                             block.size() - offset);
+      REQUIRE(log_message);
+      found = found || log_message->log_level == nvlog::LogLevel::Error;
+      offset += nvlog::EncodedRecordSize(*log_message);
+    }
+    REQUIRE(found);
+    Remove(filename);
+  }
+  SECTION("Sink restart") {
+    std::string filename = LogPath("restart.log");
+    Remove(filename);
+    auto sink = std::make_shared<nvlog::DeferredFileSink>(filename);
+    sink->EnableTimeIndex(1 << 20);
+    auto start = std::chrono::system_clock::now();
+    for (int run = 0; run < 2; ++run) {
+      sink->Start();
+      sink->Log(nvlog::MakeLogMessage(start + std::chrono::hours(run),
+                                      nvlog::LogLevel::Info, "IDX",
+                                      "run " + std::to_string(run), __FILE__,
+                                      __LINE__, nvlog::GetThreadId()));
+      sink->Shutdown();
+    }
+
+    int64_t second_run = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             (start + std::chrono::hours(1)).time_since_epoch())
+                             .count();
+    auto ranges = Query(filename, second_run, second_run,
+                        nvlog::LogLevel::Trace);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].indexed);
+    REQUIRE(ranges[0].offset > 0);
+
+    std::ifstream file(filename);
+    std::string text(ranges[0].size, '\0');
+    file.seekg(static_cast<std::streamoff>(ranges[0].offset));
+    file.read(&text[0], static_cast<std::streamsize>(text.size()));
+    REQUIRE(text.find("run 1") != std::string::npos);
+    REQUIRE(text.find("run 0") == std::string::npos);
+    Remove(filename);
+  }
+
+  SECTION("Emergency drain") {
+    std::string filename = LogPath("drain.log");
+    Remove(filename);
+    auto sink = std::make_shared<nvlog::DeferredFileSink>(
+        filename, 1 << 20, std::chrono::seconds(3600));
+    sink->EnableTimeIndex(1 << 20);
+    sink->Start();
+    auto now = std::chrono::system_clock::now();
+    sink->Log(nvlog::MakeLogMessage(now, nvlog::LogLevel::Info, "IDX",
+                                    "buffered", __FILE__, __LINE__,
+                                    nvlog::GetThreadId()));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (sink->Stats().processed < 1 &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    sink->EmergencyDrain(-1);
+
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     now.time_since_epoch())
+                     .count();
+    auto ranges = Query(filename, ns, ns, nvlog::LogLevel::Trace);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].indexed);
+    REQUIRE(ranges[0].offset == 0);
+    std::ifstream file(filename);
+    std::string text(ranges[0].size, '\0');
+    file.read(&text[0], static_cast<std::streamsize>(text.size()));
+    REQUIRE(text.find("buffered") != std::string::npos);
+    sink->Shutdown();
+    Remove(filename);
+  }
+}
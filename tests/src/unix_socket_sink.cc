@@ -0,0 +1,289 @@
+#include "nvlog/unix_socket_sink.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <catch2/catch_all.hpp>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Explanation
+// # Datagram / Stream:
+//
+// A local collector bound to a temporary socket path receives every record
+// of the sink, one datagram per record or one line per record.
+//
+// # Spill and reconnect:
+//
+// Records logged while no collector listens are kept and delivered once it
+// comes up; with a small spill buffer the oldest ones are dropped and
+// counted instead.
+//
+// # Torn record:
+//
+// A collector that stops reading makes a large stream record time out half
+// sent. That record is counted as dropped; the next connection starts with
+// the following record instead of resending the torn one.
+
+namespace {
+
+std::string SocketPath(const std::string& name) {
+  return "/tmp/nvlog_test_" + std::to_string(::getpid()) + "_" + name +
+         ".sock";
+}
+
+// Local collector: bind ```path``` and collect records on a thread until
+// ```expected``` arrived or nothing came for a while
+class Collector {
+ public:
+  Collector(const std::string& path, nvlog::SocketMode mode, size_t expected,
+            int idle_ms = 3000)
+                  : path_(path),
+                    mode_(mode),
+                    expected_(expected),
+                    idle_ms_(idle_ms) {
+    ::unlink(path_.c_str());
+    int type = mode == nvlog::SocketMode::Datagram ? SOCK_DGRAM : SOCK_STREAM;
+    fd_ = ::socket(AF_UNIX, type, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path_.c_str(),
+                 sizeof(address.sun_path) - 1);
+    ::bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    if (mode == nvlog::SocketMode::Stream) {
+      ::listen(fd_, 4);
+    }
+    thread_ = std::thread(&Collector::Run, this);
+  }
+
+  ~Collector() {
+    Join();
+    ::close(fd_);
+    ::unlink(path_.c_str());
+  }
+
+  void Join() {
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  // Every record received, in order
+  std::vector<std::string> Records() {
+    Join();
+    return records_;
+  }
+
+ private:
+  bool Wait(int fd) {
+    pollfd p = {fd, POLLIN, 0};
+    return ::poll(&p, 1, idle_ms_) > 0;
+  }
+
+  void Run() {
+    char buffer[65536];
+    if (mode_ == nvlog::SocketMode::Datagram) {
+      while (records_.size() < expected_ && Wait(fd_)) {
+        ssize_t n = ::recv(fd_, buffer, sizeof(buffer), 0);
+        if (n >= 0) {
+          records_.emplace_back(buffer, static_cast<size_t>(n));
+        }
+      }
+      return;
+    }
+
+    std::string stream;
+    while (records_.size() < expected_ && Wait(fd_)) {
+      int connection = ::accept(fd_, nullptr, nullptr);
+      while (records_.size() < expected_ && Wait(connection)) {
+        ssize_t n = ::recv(connection, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+          break;
+        }
+        stream.append(buffer, static_cast<size_t>(n));
+        size_t end;
+        while ((end = stream.find('\n')) != std::string::npos) {
+          records_.push_back(stream.substr(0, end));
+          stream.erase(0, end + 1);
+        }
+      }
+      ::close(connection);
+    }
+  }
+
+  std::string path_;
+  nvlog::SocketMode mode_;
+  size_t expected_;
+  int idle_ms_;
+  int fd_;
+  std::thread thread_;
+  std::vector<std::string> records_;
+};
+
+nvlog::LogMessagePtr MakeMessage(int i) {
+  return nvlog::MakeLogMessage(std::chrono::system_clock::now(),
+                               nvlog::LogLevel::Info, "SOCK", std::to_string(i),
+                               __FILE__, __LINE__, nvlog::GetThreadId());
+}
+
+void PlainFormatter(std::ostringstream& ss,
+                    const nvlog::LogMessage& log_message) {
+  ss << log_message.message;
+}
+
+// Listening socket that never accepts on its own, connections queue up
+int Listen(const std::string& path) {
+  ::unlink(path.c_str());
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+  ::listen(fd, 4);
+  return fd;
+}
+
+// Accept the next queued connection and read it until the sink closed it
+std::string ReadConnection(int listen_fd) {
+  int connection = ::accept(listen_fd, nullptr, nullptr);
+  std::string text;
+  char buffer[65536];
+  ssize_t n;
+  while ((n = ::recv(connection, buffer, sizeof(buffer), 0)) > 0) {
+    text.append(buffer, static_cast<size_t>(n));
+  }
+  ::close(connection);
+  return text;
+}
+
+void Deliver(nvlog::SocketMode mode) {
+  std::string path = SocketPath(mode == nvlog::SocketMode::Datagram ? "dgram"
+                                                                    : "stream");
+  const int records = 2000;
+  Collector collector(path, mode, records);
+
+  nvlog::UnixSocketSinkOptions options;
+  options.mode = mode;
+  auto sink = std::make_shared<nvlog::UnixSocketSink>(path, options);
+  sink->SetFormatter(PlainFormatter);
+  sink->Start();
+  for (int i = 0; i < records; ++i) {
+    sink->Log(MakeMessage(i));
+  }
+  sink->Shutdown();
+
+  std::vector<std::string> received = collector.Records();
+  REQUIRE(received.size() == records);
+  bool ordered = true;
+  for (int i = 0; i < records; ++i) {
+    ordered = ordered && received[i] == std::to_string(i);
+  }
+  REQUIRE(ordered);
+  REQUIRE(sink->Dropped() == 0);
+  REQUIRE(sink->Stats().processed == records);
+}
+
+}  // namespace
+
+TEST_CASE("UnixSocketSink Test") {
+  SECTION("Datagram") {
+    Deliver(nvlog::SocketMode::Datagram);
+  }
+
+  SECTION("Stream") {
+    Deliver(nvlog::SocketMode::Stream);
+  }
+
+  SECTION("Spill and reconnect") {
+    std::string path = SocketPath("spill");
+    ::unlink(path.c_str());
+
+    nvlog::UnixSocketSinkOptions options;
+    options.mode = nvlog::SocketMode::Stream;
+    options.min_backoff = std::chrono::milliseconds(1);
+    auto sink = std::make_shared<nvlog::UnixSocketSink>(path, options);
+    sink->SetFormatter(PlainFormatter);
+    sink->Start();
+    for (int i = 0; i < 100; ++i) {
+      sink->Log(MakeMessage(i));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(sink->Connected());
+
+    Collector collector(path, nvlog::SocketMode::Stream, 101);
+    sink->Log(MakeMessage(100));
+    sink->Shutdown();
+
+    std::vector<std::string> received = collector.Records();
+    REQUIRE(received.size() == 101);
+    REQUIRE(received.front() == "0");
+    REQUIRE(received.back() == "100");
+  }
+
+  SECTION("Bounded spill") {
+    std::string path = SocketPath("bounded");
+    ::unlink(path.c_str());
+
+    nvlog::UnixSocketSinkOptions options;
+    options.spill_bytes = 64;
+    options.min_backoff = std::chrono::milliseconds(1);
+    auto sink = std::make_shared<nvlog::UnixSocketSink>(path, options);
+    sink->SetFormatter(PlainFormatter);
+    sink->Start();
+    for (int i = 0; i < 100; ++i) {
+      sink->Log(MakeMessage(i));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    Collector collector(path, nvlog::SocketMode::Datagram, 100, 200);
+    sink->Shutdown();
+
+    std::vector<std::string> received = collector.Records();
+    REQUIRE(sink->Dropped() > 0);
+    REQUIRE(received.size() + sink->Dropped() == 100);
+    REQUIRE(received.back() == "99");
+  }
+
+  SECTION("Torn record") {
+    std::string path = SocketPath("torn");
+    int listen_fd = Listen(path);
+
+    nvlog::UnixSocketSinkOptions options;
+    options.mode = nvlog::SocketMode::Stream;
+    options.batch_records = 1;
+    options.send_timeout = std::chrono::milliseconds(50);
+    options.min_backoff = std::chrono::milliseconds(1);
+    auto sink = std::make_shared<nvlog::UnixSocketSink>(path, options);
+    sink->SetFormatter(PlainFormatter);
+    sink->Start();
+
+    // Far above the socket buffer, nothing reads it yet
+    auto large = nvlog::MakeLogMessage(
+        std::chrono::system_clock::now(), nvlog::LogLevel::Info, "SOCK",
+        std::string(8 << 20, 'x'), __FILE__, __LINE__, nvlog::GetThreadId());
+    sink->Log(large);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (sink->Dropped() == 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(sink->Dropped() == 1);
+
+    sink->Log(MakeMessage(1));
+    sink->Shutdown();
+
+    std::string torn = ReadConnection(listen_fd);
+    REQUIRE_FALSE(torn.empty());
+    REQUIRE(torn.size() < large->message.size());
+    REQUIRE(torn.find('\n') == std::string::npos);
+    REQUIRE(ReadConnection(listen_fd) == "1\n");
+    REQUIRE(sink->Dropped() == 1);
+
+    ::close(listen_fd);
+    ::unlink(path.c_str());
+  }
+}
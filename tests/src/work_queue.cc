@@ -0,0 +1,57 @@
+#include "nvlog/work_queue.h"
+
+#include <catch2/catch_all.hpp>
+#include <thread>
+#include <vector>
+
+// Explanation
+// # Wait strategies:
+//
+// Multiple producers enqueue into one worker for every wait strategy,
+// the worker must receive every item exactly once and in order per
+// producer, including items enqueued while it is parked or asleep.
+
+TEST_CASE("WorkQueue Test") {
+  auto strategy = GENERATE(
+      nvlog::WaitStrategy::Blocking, nvlog::WaitStrategy::SpinYield,
+      nvlog::WaitStrategy::SpinPark, nvlog::WaitStrategy::BusySpin);
+
+  nvlog::WorkQueue<int> queue(strategy);
+  const int producers = 4;
+  const int items = 5000;
+
+  std::vector<int> last(producers, -1);
+  int received = 0;
+  bool ordered = true;
+  std::thread consumer([&]() {
+    while (received < producers * items) {
+      int value;
+      queue.WaitAndDequeue(value);
+      int producer = value / items;
+      ordered = ordered && value % items == last[producer] + 1;
+      last[producer] = value % items;
+      ++received;
+    }
+  });
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&queue, p]() {
+      for (int i = 0; i < items; ++i) {
+        queue.Enqueue(p * items + i);
+        if (i % 1000 == 0) {
+          // let the worker park or sleep
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  consumer.join();
+
+  REQUIRE(received == producers * items);
+  REQUIRE(ordered);
+  REQUIRE(queue.Empty());
+}
@@ -0,0 +1,39 @@
+#include <iostream>
+#include <string>
+
+#include "nvlog/nvlog.h"
+
+// Print the content of a flight recorder ring, oldest record first.
+//
+// Usage: nvlog_dump [--simple] <file>
+int main(int argc, char* argv[]) {
+  nvlog::Formatter formatter = nvlog::DefaultFormatter;
+  std::string filename;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--simple") {
+      formatter = nvlog::SimpleFormatter;
+    } else {
+      filename = arg;
+    }
+  }
+
+  if (filename.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [--simple] <file>" << std::endl;
+    return 1;
+  }
+
+  bool ok = nvlog::ReadFlightRecorder(
+      filename, [formatter](const nvlog::LogMessage& log_message) {
+        std::ostringstream ss;
+        formatter(ss, log_message);
+        std::cout << ss.str() << '\n';
+      });
+  if (!ok) {
+    std::cerr << filename << ": not a flight recorder file" << std::endl;
+    return 1;
+  }
+  std::cout.flush();
+  return 0;
+}
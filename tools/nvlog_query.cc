@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "nvlog/nvlog.h"
+
+// Print the records of a log file between two times, seeking with the
+// sidecar index written by ```EnableTimeIndex()``` instead of reading the
+// whole file. The blocks found, and the text the index does not cover,
+// are then filtered record by record on time and level.
+//
+// Times are local, ```YYYY-MM-DD HH:MM:SS[.ffffff]``` (or with a ```T```),
+// or ```@<epoch seconds>```.
+//
+// Usage: nvlog_query [--from T] [--to T] [--min-level L] [--simple]
+//                    [--ranges] <file>
+namespace {
+
+constexpr size_t kChunkSize = 1024 * 1024;
+
+bool ParseTime(const std::string& text, int64_t* ns) {
+  if (!text.empty() && text[0] == '@') {
+    char* end = nullptr;
+    double seconds = std::strtod(text.c_str() + 1, &end);
+    *ns = static_cast<int64_t>(seconds * 1e9);
+    return end != text.c_str() + 1 && *end == '\0';
+  }
+
+  std::tm tm = {};
+  double seconds = 0;
+  int matched = std::sscanf(text.c_str(), "%d-%d-%d%*[ T]%d:%d:%lf",
+                            &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour,
+                            &tm.tm_min, &seconds);
+  if (matched < 3) {
+    return false;
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  tm.tm_isdst = -1;
+  int64_t whole = static_cast<int64_t>(seconds);
+  tm.tm_sec = static_cast<int>(whole);
+  std::time_t time = std::mktime(&tm);
+  if (time == -1) {
+    return false;
+  }
+  *ns = static_cast<int64_t>(time) * 1000000000 +
+        static_cast<int64_t>((seconds - whole) * 1e9);
+  return true;
+}
+
+bool ParseLevel(std::string text, nvlog::LogLevel* level) {
+  for (auto& c : text) {
+    c = static_cast<char>(std::tolower(c));
+  }
+  if (text == "trace") {
+    *level = nvlog::LogLevel::Trace;
+  } else if (text == "debug") {
+    *level = nvlog::LogLevel::Debug;
+  } else if (text == "info") {
+    *level = nvlog::LogLevel::Info;
+  } else if (text == "warn" || text == "warning") {
+    *level = nvlog::LogLevel::Warning;
+  } else if (text == "error") {
+    *level = nvlog::LogLevel::Error;
+  } else if (text == "fatal" || text == "critical") {
+    *level = nvlog::LogLevel::Fatal;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Time of a text line, read from the first ```YYYY-MM-DD HH:MM:SS.ffffff```
+// near its start (default and simple formatters). False for the other
+// lines, e.g. the second line of a default formatted record.
+bool LineTime(const char* line, size_t size, int64_t* ns) {
+  static const char kPattern[] = "dddd-dd-dd dd:dd:dd.dddddd";
+  const size_t length = sizeof(kPattern) - 1;
+  size_t limit = std::min<size_t>(size, 32 + length);
+  for (size_t start = 0; start + length <= limit; ++start) {
+    size_t i = 0;
+    for (; i < length; ++i) {
+      char c = line[start + i];
+      bool digit = std::isdigit(static_cast<unsigned char>(c)) != 0;
+      if (kPattern[i] == 'd' ? !digit : c != kPattern[i]) {
+        break;
+      }
+    }
+    if (i == length) {
+      return ParseTime(std::string(line + start, length), ns);
+    }
+  }
+  return false;
+}
+
+// Level of a text line: its first word (default formatter) or the word in
+// its leading brackets (simple formatter)
+bool LineLevel(const char* line, size_t size, nvlog::LogLevel* level) {
+  size_t start = size > 0 && line[0] == '[' ? 1 : 0;
+  size_t end = start;
+  while (end < size && std::isupper(static_cast<unsigned char>(line[end]))) {
+    ++end;
+  }
+  return end > start && ParseLevel(std::string(line + start, end - start),
+                                   level);
+}
+
+// A record starts at a line with a time, the following lines without one
+// (e.g. the message line of the default formatter) go with it. Producer
+// threads stamp records slightly out of order, so a record past ```to_ns```
+// is skipped rather than ending the range. A line whose level can't be
+// read (custom formatter) is not filtered on its level.
+void PrintText(std::ifstream& file, const nvlog::TimeIndexRange& range,
+               int64_t from_ns, int64_t to_ns, nvlog::LogLevel min_level) {
+  std::string buffer;
+  file.seekg(static_cast<std::streamoff>(range.offset));
+  uint64_t left = range.size;
+  bool printing = false;
+  while (left > 0 && file) {
+    size_t end = buffer.size();
+    size_t want = static_cast<size_t>(std::min<uint64_t>(left, kChunkSize));
+    buffer.resize(end + want);
+    file.read(&buffer[end], static_cast<std::streamsize>(want));
+    size_t got = static_cast<size_t>(file.gcount());
+    buffer.resize(end + got);
+    left -= got;
+
+    size_t consumed = 0;
+    while (true) {
+      size_t newline = buffer.find('\n', consumed);
+      if (newline == std::string::npos) {
+        if (left > 0 && file) {
+          break;  // continues in the next chunk
+        }
+        newline = buffer.size();
+      }
+      const char* line = buffer.data() + consumed;
+      size_t size = newline - consumed;
+      int64_t ns;
+      if (LineTime(line, size, &ns)) {
+        nvlog::LogLevel level;
+        printing = ns >= from_ns && ns <= to_ns &&
+                   (!LineLevel(line, size, &level) || level >= min_level);
+      }
+      if (printing) {
+        std::cout.write(line, static_cast<std::streamsize>(size));
+        if (newline < buffer.size()) {
+          std::cout << '\n';
+        }
+      }
+      consumed = std::min(newline + 1, buffer.size());
+      if (consumed == buffer.size()) {
+        break;
+      }
+    }
+    buffer.erase(0, consumed);
+  }
+}
+
+void PrintBinary(std::ifstream& file, const nvlog::TimeIndexRange& range,
+                 int64_t from_ns, int64_t to_ns, nvlog::LogLevel min_level,
+                 nvlog::Formatter formatter) {
+  std::string buffer;
+  file.seekg(static_cast<std::streamoff>(range.offset));
+  uint64_t base = range.offset;  // file offset of buffer[0]
+  uint64_t left = range.size;
+  while (left > 0 && file) {
+    size_t end = buffer.size();
+    size_t want = static_cast<size_t>(std::min<uint64_t>(left, kChunkSize));
+    buffer.resize(end + want);
+    file.read(&buffer[end], static_cast<std::streamsize>(want));
+    size_t got = static_cast<size_t>(file.gcount());
+    buffer.resize(end + got);
+    left -= got;
+
+    size_t consumed = 0;
+    while (buffer.size() - consumed >= sizeof(nvlog::RecordHeader)) {
+      nvlog::RecordHeader header;
+      std::memcpy(&header, buffer.data() + consumed, sizeof(header));
+      if (header.size < sizeof(header) || header.kind != nvlog::kRecordLog) {
+        std::cerr << "nvlog_query: corrupted record at offset "
+                  << base + consumed << std::endl;
+        return;
+      }
+      if (header.size > buffer.size() - consumed) {
+        break;  // continues in the next chunk
+      }
+      auto log_message =
+          nvlog::DecodeRecord(buffer.data() + consumed, header.size);
+      consumed += header.size;
+      if (!log_message || log_message->log_level < min_level ||
+          header.timestamp_ns < from_ns || header.timestamp_ns > to_ns) {
+        continue;
+      }
+      std::ostringstream ss;
+      formatter(ss, *log_message);
+      std::cout << ss.str() << '\n';
+    }
+    buffer.erase(0, consumed);
+    base += consumed;
+  }
+}
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " [--from T] [--to T] [--min-level L] [--simple] [--ranges]"
+               " <file>"
+            << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int64_t from_ns = std::numeric_limits<int64_t>::min();
+  int64_t to_ns = std::numeric_limits<int64_t>::max();
+  nvlog::LogLevel min_level = nvlog::LogLevel::Trace;
+  nvlog::Formatter formatter = nvlog::DefaultFormatter;
+  bool ranges_only = false;
+  std::string filename;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    bool ok = true;
+    if (arg == "--from" && has_value) {
+      ok = ParseTime(argv[++i], &from_ns);
+    } else if (arg == "--to" && has_value) {
+      ok = ParseTime(argv[++i], &to_ns);
+    } else if (arg == "--min-level" && has_value) {
+      ok = ParseLevel(argv[++i], &min_level);
+    } else if (arg == "--simple") {
+      formatter = nvlog::SimpleFormatter;
+    } else if (arg == "--ranges") {
+      ranges_only = true;
+    } else if (filename.empty() && arg[0] != '-') {
+      filename = arg;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (filename.empty()) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<nvlog::TimeIndexRange> ranges;
+  nvlog::TimeIndexFormat format;
+  if (!nvlog::QueryTimeIndex(filename, from_ns, to_ns, min_level, &ranges,
+                             &format)) {
+    std::cerr << filename << ": no time index, see EnableTimeIndex()"
+              << std::endl;
+    return 1;
+  }
+
+  if (ranges_only) {
+    for (const auto& range : ranges) {
+      std::cout << range.offset << ' ' << range.size
+                << (range.indexed ? "" : " unindexed") << '\n';
+    }
+    return 0;
+  }
+
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << filename << ": cannot open" << std::endl;
+    return 1;
+  }
+  for (const auto& range : ranges) {
+    if (format == nvlog::TimeIndexFormat::Binary) {
+      PrintBinary(file, range, from_ns, to_ns, min_level, formatter);
+    } else {
+      PrintText(file, range, from_ns, to_ns, min_level);
+    }
+    file.clear();
+  }
+  std::cout.flush();
+  return 0;
+}
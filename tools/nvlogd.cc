@@ -0,0 +1,100 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "nvlog/nvlog.h"
+
+// Drain the shared memory ring every ```ShmRingSink``` of the host publishes
+// into, and write the records through the normal sink pipeline.
+//
+// Usage: nvlogd [--name /nvlog] [--slots N] [--slot-size BYTES]
+//               [--file path] [--console] [--simple]
+namespace {
+
+volatile std::sig_atomic_t stop = 0;
+
+void OnSignal(int) {
+  stop = 1;
+}
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " [--name /nvlog] [--slots N] [--slot-size BYTES]"
+               " [--file path] [--console] [--simple]"
+            << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string name = "/nvlog";
+  std::string filename;
+  bool console = false;
+  nvlog::Formatter formatter = nvlog::DefaultFormatter;
+  nvlog::ShmRingOptions options;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--name" && has_value) {
+      name = argv[++i];
+    } else if (arg == "--slots" && has_value) {
+      options.slots = std::stoul(argv[++i]);
+    } else if (arg == "--slot-size" && has_value) {
+      options.slot_size = std::stoul(argv[++i]);
+    } else if (arg == "--file" && has_value) {
+      filename = argv[++i];
+    } else if (arg == "--console") {
+      console = true;
+    } else if (arg == "--simple") {
+      formatter = nvlog::SimpleFormatter;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<std::shared_ptr<nvlog::Sink>> sinks;
+  if (!filename.empty()) {
+    sinks.push_back(
+        std::make_shared<nvlog::DeferredFileSink>(filename, 64 * 1024));
+  }
+  if (console || sinks.empty()) {
+    sinks.push_back(std::make_shared<nvlog::ConsoleSink>());
+  }
+  for (auto& sink : sinks) {
+    sink->SetFormatter(formatter);
+  }
+
+  auto ring = nvlog::ShmRing::Create(name, options);
+  if (!ring) {
+    return 1;
+  }
+
+  nvlog::Logger logger(std::make_shared<nvlog::limiters::NullLimiter>(),
+                       sinks);
+  logger.StartEngine();
+
+  std::signal(SIGINT, OnSignal);
+  std::signal(SIGTERM, OnSignal);
+
+  auto forward = [&logger](nvlog::LogMessagePtr log_message) {
+    logger.Forward(std::move(log_message));
+  };
+  while (!stop) {
+    if (ring->Consume(forward, 4096) == 0) {
+      ring->Wait(std::chrono::milliseconds(100));
+    }
+  }
+  // The ring stays in place: publishers keep their mapping and a restarted
+  // daemon picks up what they publish meanwhile
+  ring->Consume(forward);
+  logger.ShutdownEngine();
+
+  if (ring->Abandoned() != 0 || ring->Corrupted() != 0 || ring->Full() != 0) {
+    std::cerr << "nvlogd: abandoned=" << ring->Abandoned()
+              << " corrupted=" << ring->Corrupted()
+              << " full=" << ring->Full() << std::endl;
+  }
+  return 0;
+}